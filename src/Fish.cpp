@@ -10,242 +10,249 @@
 #include "random_functions.h"
 //#include "randomc.h"
 #include <algorithm>
+#include <cstring>
 
 
 #include <Rcpp.h>
 using namespace Rcpp;
 
-bool do_recombination(std::vector<junction>& offspring,
-                      const std::vector<junction>& chromosome1,
-                      const std::vector<junction>& chromosome2,
-                      const std::vector<double>& recomPos) {
-
-    std::vector< junction > toAdd; //first create junctions on exactly the recombination positions
-    for(int i = 0; i < recomPos.size(); ++i) {
-        junction temp;
-        temp.right = -1.0;
-        temp.pos = recomPos[i];
-        toAdd.push_back(temp);
+template <typename JUNCTION>
+inline void add_junction(std::vector<JUNCTION>& offspring,
+                         size_t start,
+                         const JUNCTION& j) {
+    // no junction is needed if ancestry does not change
+    if(offspring.size() == start || offspring.back().right != j.right) {
+        offspring.push_back(j);
     }
+}
 
-    for(auto i = (chromosome1.begin()+1); i != chromosome1.end(); ++i) {
-        long double leftpos = (*(i-1)).pos;
-        long double rightpos = (*i).pos;
-
-        for(int j = 0; j < recomPos.size(); ++j) {
-            if(recomPos[j] == leftpos) {
-                return false;
-            }
-            if(recomPos[j] == rightpos) {
-                return false;
-            }
-
-            if(recomPos[j] > leftpos) {
-                if(recomPos[j] < rightpos) {
-                    if(j % 2 == 0) { // even, so chrom1 = L, chrom2 = R
-                        if(j < toAdd.size()) {
-                            //       toAdd[j].left = (*i).left;
-                        }
-                    } else { // uneven so chrom1 = R, chrom2 = L
-                        if(j < toAdd.size()) {
-                            toAdd[j].right = (*(i-1)).right;
-                        }
-                    }
-                }
-            }
+// Single pass over both parental chromosomes: junctions of the chromosome
+// that is currently being copied are written out in order, the other
+// chromosome is only advanced, and at every breakpoint a new junction is
+// inserted carrying the ancestry of the chromosome we switch to. The
+// offspring chromosome is appended to offspring, starting at start.
+// Returns false if a breakpoint coincides with an existing junction and
+// the junction type can not resolve this (see junction::exact_positions).
+template <typename JUNCTION>
+bool do_recombination(std::vector<JUNCTION>& offspring,
+                      size_t start,
+                      const chromosome_view<JUNCTION>& chromosome1,
+                      const chromosome_view<JUNCTION>& chromosome2,
+                      const std::vector<typename JUNCTION::position_type>& recomPos) {
+
+    const chromosome_view<JUNCTION>* parent[2] = {&chromosome1, &chromosome2};
+    size_t index[2] = {0, 0};
+    int focal = 0; // even segments are copied from chromosome1, odd from chromosome2
+
+    for(size_t i = 0; i < recomPos.size(); ++i) {
+        typename JUNCTION::position_type pos = recomPos[i];
+
+        // copy junctions of the focal chromosome up to the breakpoint
+        const chromosome_view<JUNCTION>& source = *parent[focal];
+        while(index[focal] < source.size() && source[index[focal]].pos < pos) {
+            add_junction(offspring, start, source[index[focal]]);
+            index[focal]++;
         }
-    }
-
-    for(auto i = (chromosome2.begin()+1); i != chromosome2.end(); ++i) {
-        long double leftpos = (*(i-1)).pos;
-        long double rightpos = (*i).pos;
-
-        for(int j = 0; j < recomPos.size(); ++j) {
-            if(recomPos[j] == leftpos) {
-                return false;
-            }
-            if(recomPos[j] == rightpos) {
-                return false;
-            }
-
-            if(recomPos[j] > leftpos) {
-                if(recomPos[j] < rightpos) {
-                    if(j % 2 == 0) { //even, so chrom1 = L, chrom2 = R
-                        if(j < toAdd.size()) {
-                            toAdd[j].right = (*(i-1)).right;
-                        }
-                    } else { //uneven so chrom1 = R, chrom2 = L
-                        if(j < toAdd.size()) {
-                            //    toAdd[j].left = (*i).left;
-                        }
-                    }
-                }
-            }
+        if(index[focal] < source.size() && source[index[focal]].pos == pos) {
+            if(!JUNCTION::exact_positions) return false;
         }
-    }
 
-    for(int i = 0; i < toAdd.size(); ++i) {
-        if(toAdd[i].right == -1 && toAdd[i].pos < 1) {
-            Rcout << "This break point was not addressed!\n";
-            stop("Error in toAdd");
+        // skip junctions of the other chromosome up to the breakpoint
+        int other = 1 - focal;
+        const chromosome_view<JUNCTION>& target = *parent[other];
+        while(index[other] < target.size() && target[index[other]].pos < pos) {
+            index[other]++;
         }
-        offspring.push_back(toAdd[i]);
-    }
-
-    //now we have to add the other junctions from chrom1 and chrom2.
-    long double leftpos = 0;
-    long double rightpos = 0;
-
 
-    for(int i = 0; i < (recomPos.size() + 1); ++i) {
-        rightpos = 1.0;
-        if(i < recomPos.size()) rightpos = recomPos[i];
-
-        if(i % 2 == 0) { //even, so take from chromosome 1
-            for(auto it = chromosome1.begin(); it != chromosome1.end(); ++it) {
-                if((*it).pos >= leftpos && (*it).pos <= rightpos) {
-                    offspring.push_back((*it));
-                }
-                if((*it).pos > rightpos) { //we are past the recombination section
-                    break;
-                }
-            }
+        // ancestry to the right of the breakpoint is that of the block
+        // of the other chromosome in which the breakpoint falls
+        int right;
+        if(index[other] < target.size() && target[index[other]].pos == pos) {
+            if(!JUNCTION::exact_positions) return false;
+            right = target[index[other]].right;
+        } else {
+            right = target[index[other] - 1].right;
         }
 
-        if(i % 2 == 1) { //odd, so take from chromosome 2
-            for(auto it = chromosome2.begin(); it != chromosome2.end(); ++it) {
-                if((*it).pos >= leftpos && (*it).pos <= rightpos) {
-                    offspring.push_back((*it));
-                }
-                if((*it).pos > rightpos) { //we are past the recombination section
-                    break;
-                }
-            }
-        }
+        add_junction(offspring, start, JUNCTION(pos, right));
 
-        //move forward
-        leftpos = rightpos;
+        focal = other;
     }
 
-    std::sort(offspring.begin(), offspring.end());
-    // gatekeeper code to not allow false junctions to be introduced
-
-    std::vector<junction> temp_offspring = offspring;
-    offspring.clear();
-    for(int i = 0; i < temp_offspring.size(); ++i) {  // extra checks to make sure no memory access errors
-        bool add = true;
-
-        if(i > 0) {
-            if(temp_offspring[i].right == temp_offspring[i-1].right) add = false;
-
-            if(temp_offspring[i].pos == temp_offspring[i-1].pos) add = false;
-        }
+    // copy the remainder, including the end of the chromosome
+    const chromosome_view<JUNCTION>& source = *parent[focal];
+    for(size_t i = index[focal]; i < source.size(); ++i) {
+        add_junction(offspring, start, source[i]);
+    }
 
-        // if a bad memory access call happens, we get weird numbers in .right:
-        if(abs(temp_offspring[i].right) > 1000) add = false;
+    return true;
+}
 
-        if(add == true) {
-            offspring.push_back(temp_offspring[i]);
+// convert breakpoints to the position type of the junction. Two
+// breakpoints that map onto the same position cancel each other out.
+template <typename JUNCTION>
+void encode_recomPos(const std::vector<double>& recomPos,
+                     std::vector<typename JUNCTION::position_type>& output) {
+    output.clear();
+    for(size_t i = 0; i < recomPos.size(); ++i) {
+        typename JUNCTION::position_type pos = JUNCTION::encode(recomPos[i]);
+        if(!output.empty() && output.back() == pos) {
+            output.pop_back();
+        } else {
+            output.push_back(pos);
         }
     }
-    return true;
 }
 
-std::vector<double> generate_recomPos(int number_of_recombinations) {
-
-    std::vector<double> recomPos(number_of_recombinations, 0);
-    for(int i = 0; i < number_of_recombinations; ++i) {
-        recomPos[i] = uniform();
-    }
-    std::sort(recomPos.begin(), recomPos.end() );
-    recomPos.erase(std::unique(recomPos.begin(), recomPos.end()), recomPos.end());
-
-    while (recomPos.size() < number_of_recombinations) {
-        double pos = uniform();
-        recomPos.push_back(pos);
-        // sort them, in case they are not sorted yet
-        // we need this to remove duplicates, and later
-        // to apply crossover
-        std::sort(recomPos.begin(), recomPos.end() );
-        // remove duplicate recombination sites
-        recomPos.erase(std::unique(recomPos.begin(), recomPos.end()), recomPos.end());
+// Draws sorted, distinct breakpoints on [0, 1) directly: the partial sums of
+// number_of_recombinations + 1 exponential spacings, divided by their total,
+// are distributed as the order statistics of number_of_recombinations
+// uniform draws.
+void generate_recomPos(int number_of_recombinations,
+                       std::vector<double>& recomPos) {
+
+    recomPos.resize(number_of_recombinations);
+    bool recomPos_is_sorted = false;
+    while(!recomPos_is_sorted) {
+        double total = 0.0;
+        for(int i = 0; i < number_of_recombinations; ++i) {
+            total += exponential();
+            recomPos[i] = total;
+        }
+        total += exponential();
+
+        recomPos_is_sorted = true;
+        double previous = -1.0;
+        for(int i = 0; i < number_of_recombinations; ++i) {
+            recomPos[i] /= total;
+            // rounding can, very rarely, produce duplicates or 1.0
+            if(recomPos[i] <= previous || recomPos[i] >= 1.0) {
+                recomPos_is_sorted = false;
+            }
+            previous = recomPos[i];
+        }
     }
-    return recomPos;
+    return;
 }
 
-void Recombine(      std::vector<junction>& offspring,
-               const std::vector<junction>& chromosome1,
-               const std::vector<junction>& chromosome2,
-               double MORGAN)  {
+// returns false if chromosome1 is passed on without recombination, in which
+// case it is only appended to offspring if copy_intact is true.
+template <typename JUNCTION>
+bool Recombine(      std::vector<JUNCTION>& offspring,
+               const chromosome_view<JUNCTION>& chromosome1,
+               const chromosome_view<JUNCTION>& chromosome2,
+               double MORGAN,
+               bool copy_intact)  {
 
-    int numRecombinations = poisson_preset();
+    int numRecombinations = poisson(MORGAN);
 
     if (numRecombinations == 0) {
-        offspring.insert(offspring.end(),
-                         chromosome1.begin(),
-                         chromosome1.end());
+        if (copy_intact) {
+            offspring.insert(offspring.end(),
+                             chromosome1.begin(),
+                             chromosome1.end());
+        }
 
-        return;
+        return false;
     }
 
-    std::vector<double> recomPos = generate_recomPos(numRecombinations);
+    // offspring can be the junctions of a whole population, it is left to
+    // grow geometrically
+    size_t start = offspring.size();
+
+    // breakpoint buffers are reused across meioses
+    static thread_local std::vector<double> recomPos;
+    static thread_local std::vector<typename JUNCTION::position_type> positions;
+
+    generate_recomPos(numRecombinations, recomPos);
+    encode_recomPos<JUNCTION>(recomPos, positions);
 
     bool recomPos_is_unique = do_recombination(offspring,
+                                               start,
                                                chromosome1,
                                                chromosome2,
-                                               recomPos);
+                                               positions);
     // very rarely, the recombination positions are exactly
     // on existing junctions - this should not happen.
+    // This can only occur for non-exact junction positions.
     while(recomPos_is_unique == false) {
+        offspring.erase(offspring.begin() + start, offspring.end());
 
-        recomPos = generate_recomPos(numRecombinations);
+        generate_recomPos(numRecombinations, recomPos);
+        encode_recomPos<JUNCTION>(recomPos, positions);
 
         recomPos_is_unique = do_recombination(offspring,
+                                              start,
                                               chromosome1,
                                               chromosome2,
-                                              recomPos);
+                                              positions);
     }
 
-    return;
+    return true;
 }
 
-Fish mate(const Fish& A, const Fish& B, double numRecombinations)
-{
-    Fish offspring;
-    offspring.chromosome1.clear();
-    offspring.chromosome2.clear(); //just to be sure.
-
-    //first the father chromosome
+template <typename JUNCTION>
+int inherit_chromosome(std::vector<JUNCTION>& offspring,
+                       const chromosome_view<JUNCTION>& chromosome1,
+                       const chromosome_view<JUNCTION>& chromosome2,
+                       double morgan,
+                       bool copy_intact) {
     int event = random_number(2);
+    bool recombined = true;
     switch(event) {
         case 0:  {
-            Recombine(offspring.chromosome1, A.chromosome1, A.chromosome2, numRecombinations);
+            recombined = Recombine(offspring, chromosome1, chromosome2, morgan,
+                                   copy_intact);
             break;
         }
         case 1: {
-            Recombine(offspring.chromosome1, A.chromosome2, A.chromosome1, numRecombinations);
+            recombined = Recombine(offspring, chromosome2, chromosome1, morgan,
+                                   copy_intact);
             break;
         }
     }
+    return recombined ? -1 : event;
+}
 
+template <typename JUNCTION>
+int draw_meiosis(std::vector<typename JUNCTION::position_type>& breakpoints,
+                 double morgan) {
+    int event = random_number(2);
+    int numRecombinations = poisson(morgan);
 
-    //then the mother chromosome
-    event = random_number(2);
-    switch(event) {
-        case 0:  {
-            Recombine(offspring.chromosome2, B.chromosome1, B.chromosome2, numRecombinations);
-            break;
-        }
-        case 1: {
-            Recombine(offspring.chromosome2, B.chromosome2, B.chromosome1, numRecombinations);
-            break;
-        }
+    breakpoints.clear();
+    if (numRecombinations > 0) {
+        static thread_local std::vector<double> recomPos;
+        generate_recomPos(numRecombinations, recomPos);
+        encode_recomPos<JUNCTION>(recomPos, breakpoints);
     }
+    return event;
+}
+
+template <typename JUNCTION>
+Fish_t<JUNCTION> mate(const Fish_t<JUNCTION>& A,
+                      const Fish_t<JUNCTION>& B,
+                      double numRecombinations)
+{
+    Fish_t<JUNCTION> offspring;
+    offspring.chromosome1.clear();
+    offspring.chromosome2.clear(); //just to be sure.
+
+    //first the father chromosome
+    inherit_chromosome<JUNCTION>(offspring.chromosome1,
+                                 A.chromosome1, A.chromosome2,
+                                 numRecombinations);
+
+    //then the mother chromosome
+    inherit_chromosome<JUNCTION>(offspring.chromosome2,
+                                 B.chromosome1, B.chromosome2,
+                                 numRecombinations);
 
     return offspring;
 }
 
-Fish::Fish(){
+template <typename JUNCTION>
+Fish_t<JUNCTION>::Fish_t(){
 
 }
 
@@ -278,11 +285,48 @@ bool junction::operator !=(const junction& other) const {
     return( !( (*this) == other) );
 }
 
-Fish::Fish(int initLoc)    {
-    junction left(0.0, initLoc);
-    junction right(1,  -1);
+uint64_t junction::hash() const {
+    // positions are drawn as double, such that no information is lost
+    double p = static_cast<double>(pos);
+    uint64_t bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    return bits ^ (static_cast<uint64_t>(static_cast<uint32_t>(right)) << 32);
+}
+
+template <typename JUNCTION>
+Fish_t<JUNCTION>::Fish_t(int initLoc)    {
+    JUNCTION left(JUNCTION::encode(0.0), initLoc);
+    JUNCTION right(JUNCTION::encode(1.0),  -1);
     chromosome1.push_back( left  );
     chromosome1.push_back( right );
     chromosome2.push_back( left  );
     chromosome2.push_back( right );
-}
\ No newline at end of file
+}
+
+template struct Fish_t<junction>;
+template struct Fish_t<junction_fixed32>;
+template struct Fish_t<junction_fixed64>;
+
+template Fish_t<junction> mate(const Fish_t<junction>&,
+                               const Fish_t<junction>&, double);
+template Fish_t<junction_fixed32> mate(const Fish_t<junction_fixed32>&,
+                                       const Fish_t<junction_fixed32>&, double);
+template Fish_t<junction_fixed64> mate(const Fish_t<junction_fixed64>&,
+                                       const Fish_t<junction_fixed64>&, double);
+
+template int inherit_chromosome(std::vector<junction>&,
+                                const chromosome_view<junction>&,
+                                const chromosome_view<junction>&, double,
+                                bool);
+template int inherit_chromosome(std::vector<junction_fixed32>&,
+                                const chromosome_view<junction_fixed32>&,
+                                const chromosome_view<junction_fixed32>&, double,
+                                bool);
+template int inherit_chromosome(std::vector<junction_fixed64>&,
+                                const chromosome_view<junction_fixed64>&,
+                                const chromosome_view<junction_fixed64>&, double,
+                                bool);
+
+template int draw_meiosis<junction>(std::vector<long double>&, double);
+template int draw_meiosis<junction_fixed32>(std::vector<uint32_t>&, double);
+template int draw_meiosis<junction_fixed64>(std::vector<uint64_t>&, double);
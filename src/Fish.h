@@ -11,8 +11,16 @@
 
 #include <stdio.h>
 #include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
 
 struct junction {
+    typedef long double position_type;
+    // positions are stored as floating point, a breakpoint that falls
+    // exactly on an existing junction can not be resolved and is redrawn.
+    static const bool exact_positions = false;
+
     long double pos;
     int right;
 
@@ -22,19 +30,136 @@ struct junction {
     bool operator ==(const junction& other) const;
     bool operator <(const junction& other) const;
     bool operator !=(const junction& other) const;
+    uint64_t hash() const;
+
+    static long double encode(double p) { return p; }
+    static double decode(long double p) { return static_cast<double>(p); }
+};
+
+// Compact junction, the position is stored as a fixed-point integer on
+// [0, 1), where the maximum value of POS represents the end of the
+// chromosome, and the ancestry as a 32-bit label, wide enough for any
+// ancestry that R can pass in.
+template <typename POS, typename LABEL>
+struct fixed_junction {
+    typedef POS position_type;
+    // positions are exact integers, a breakpoint on an existing junction
+    // is resolved by taking ancestry at and beyond the breakpoint from the
+    // other chromosome.
+    static const bool exact_positions = true;
+
+    POS pos;
+    LABEL right;
+
+    fixed_junction() {}
+    fixed_junction(POS loc, int B) : pos(loc), right(static_cast<LABEL>(B)) {}
+
+    bool operator ==(const fixed_junction& other) const {
+        return pos == other.pos && right == other.right;
+    }
+    bool operator <(const fixed_junction& other) const {
+        return pos < other.pos;
+    }
+    bool operator !=(const fixed_junction& other) const {
+        return !((*this) == other);
+    }
+    uint64_t hash() const {
+        return static_cast<uint64_t>(pos) ^
+               (static_cast<uint64_t>(static_cast<uint32_t>(right)) << 32);
+    }
+
+    static POS encode(double p) {
+        const POS end = std::numeric_limits<POS>::max();
+        if(p <= 0.0) return 0;
+        if(p >= 1.0) return end;
+        long double scaled = std::ldexp(static_cast<long double>(p),
+                                        std::numeric_limits<POS>::digits);
+        if(scaled >= static_cast<long double>(end)) return end;
+        return static_cast<POS>(scaled);
+    }
+
+    static double decode(POS p) {
+        if(p == std::numeric_limits<POS>::max()) return 1.0;
+        return static_cast<double>(
+                    std::ldexp(static_cast<long double>(p),
+                               -std::numeric_limits<POS>::digits));
+    }
 };
 
+typedef fixed_junction<uint32_t, int32_t> junction_fixed32; //  8 bytes
+typedef fixed_junction<uint64_t, int32_t> junction_fixed64; // 16 bytes
 
-struct Fish {
-    std::vector< junction > chromosome1;
-    std::vector< junction > chromosome2;
+// Read-only view on the junctions of a single chromosome, which can either
+// be stored in a Fish or in the flat buffer of a Population_t.
+template <typename JUNCTION>
+struct chromosome_view {
+    const JUNCTION* first;
+    const JUNCTION* last;
 
-    Fish();
+    chromosome_view(const JUNCTION* b, const JUNCTION* e) : first(b), last(e) {}
+    chromosome_view(const std::vector<JUNCTION>& v) :
+        first(v.data()), last(v.data() + v.size()) {}
 
-    Fish(int initLoc);
+    size_t size() const { return last - first; }
+    const JUNCTION& operator[](size_t i) const { return first[i]; }
+    const JUNCTION* begin() const { return first; }
+    const JUNCTION* end() const { return last; }
 };
 
+// splitmix64 finalizer
+inline uint64_t mix_hash(uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// 64 bit hash of the sequence of junctions of a chromosome, chromosomes with
+// identical junctions have identical hashes.
+template <typename JUNCTION>
+uint64_t hash_chromosome(const chromosome_view<JUNCTION>& chrom) {
+    uint64_t h = chrom.size();
+    for(const JUNCTION* it = chrom.begin(); it != chrom.end(); ++it) {
+        h = mix_hash(h ^ it->hash());
+    }
+    return h;
+}
+
+template <typename JUNCTION>
+struct Fish_t {
+    typedef JUNCTION junction_type;
+
+    std::vector< JUNCTION > chromosome1;
+    std::vector< JUNCTION > chromosome2;
+
+    Fish_t();
+
+    Fish_t(int initLoc);
+};
+
+typedef Fish_t<junction> Fish;
+
+// appends to offspring the chromosome inherited from a parent carrying
+// chromosome1 and chromosome2. Returns 0 or 1 if chromosome1 or chromosome2
+// was passed on without recombination, and -1 otherwise. A chromosome passed
+// on without recombination is only appended if copy_intact is true.
+template <typename JUNCTION>
+int inherit_chromosome(std::vector<JUNCTION>& offspring,
+                       const chromosome_view<JUNCTION>& chromosome1,
+                       const chromosome_view<JUNCTION>& chromosome2,
+                       double morgan,
+                       bool copy_intact = true);
+
+// draws a meiosis from the same random numbers as inherit_chromosome, without
+// recombining any junctions: returns the parental chromosome (0 or 1) that
+// the offspring chromosome starts with, and fills breakpoints with the sorted
+// positions at which it switches to the other parental chromosome.
+template <typename JUNCTION>
+int draw_meiosis(std::vector<typename JUNCTION::position_type>& breakpoints,
+                 double morgan);
 
-Fish mate(const Fish& A, const Fish& B, double numRecombinations);
+template <typename JUNCTION>
+Fish_t<JUNCTION> mate(const Fish_t<JUNCTION>& A,
+                      const Fish_t<JUNCTION>& B,
+                      double numRecombinations);
 
 #endif /* Fish_hpp */
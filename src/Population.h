@@ -0,0 +1,234 @@
+//
+//  Population.h
+//
+//
+//  Flat storage of all chromosomes of a population: the junctions of all
+//  chromosomes are stored in a single buffer, and chromosome k spans
+//  [spans[k].begin, spans[k].end) of that buffer. The genome of an
+//  individual consists of num_chromosome_pairs pairs of chromosomes, and
+//  chromosome h (0 or 1) of pair c of individual i is chromosome
+//  2 (i num_chromosome_pairs + c) + h. Clearing a population keeps its
+//  memory, such that two populations can be reused as current and next
+//  generation.
+//  The hash of chromosome k is kept in hashes[k]. Chromosomes are interned:
+//  a chromosome that is identical to a chromosome added before shares its
+//  junctions, such that a population close to fixation only stores the
+//  few distinct chromosomes it carries.
+//  When simulating with selection, every chromosome also carries a bitset of
+//  selected_words words, where bit l is set if the chromosome carries the
+//  selected ancestry at locus l of the selection plan.
+//
+
+#ifndef Population_hpp
+#define Population_hpp
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include "Fish.h"
+
+struct chromosome_span {
+    size_t begin;
+    size_t end;
+
+    chromosome_span(size_t b, size_t e) : begin(b), end(e) {}
+};
+
+template <typename JUNCTION>
+struct Population_t {
+    std::vector< JUNCTION > junctions;
+    std::vector< chromosome_span > spans;
+    std::vector< uint64_t > hashes;
+    std::vector< uint64_t > selected_alleles;
+    size_t selected_words;
+    size_t num_chromosome_pairs;
+
+    Population_t() : selected_words(0), num_chromosome_pairs(1),
+                     open_begin(0) {}
+
+    explicit Population_t(const std::vector< Fish_t<JUNCTION> >& v) :
+        selected_words(0), num_chromosome_pairs(1), open_begin(0) {
+        for(auto it = v.begin(); it != v.end(); ++it) {
+            add_individual(*it);
+        }
+    }
+
+    // number of individuals
+    size_t size() const { return spans.size() / (2 * num_chromosome_pairs); }
+
+    size_t num_chromosomes() const { return spans.size(); }
+
+    // chromosome homolog (0 or 1) of pair of individual
+    size_t chromosome_index(size_t individual, size_t pair, int homolog) const {
+        return 2 * (individual * num_chromosome_pairs + pair) + homolog;
+    }
+
+    // the pair that chromosome k belongs to
+    size_t pair_of(size_t k) const { return (k / 2) % num_chromosome_pairs; }
+
+    chromosome_view<JUNCTION> chromosome(size_t k) const {
+        return chromosome_view<JUNCTION>(junctions.data() + spans[k].begin,
+                                         junctions.data() + spans[k].end);
+    }
+
+    chromosome_view<JUNCTION> chromosome1(size_t individual,
+                                          size_t pair = 0) const {
+        return chromosome(chromosome_index(individual, pair, 0));
+    }
+
+    chromosome_view<JUNCTION> chromosome2(size_t individual,
+                                          size_t pair = 0) const {
+        return chromosome(chromosome_index(individual, pair, 1));
+    }
+
+    // total number of junctions, where shared junctions count for every
+    // chromosome that carries them
+    size_t num_junctions() const {
+        size_t total = 0;
+        for(auto it = spans.begin(); it != spans.end(); ++it) {
+            total += it->end - it->begin;
+        }
+        return total;
+    }
+
+    const uint64_t* selected(size_t k) const {
+        return selected_alleles.data() + k * selected_words;
+    }
+
+    uint64_t* selected(size_t k) {
+        return selected_alleles.data() + k * selected_words;
+    }
+
+    void clear() {
+        junctions.clear();
+        spans.clear();
+        hashes.clear();
+        selected_alleles.clear();
+        interned.clear();
+        open_begin = 0;
+    }
+
+    void reserve(size_t num_individuals) {
+        spans.reserve(2 * num_individuals);
+        hashes.reserve(2 * num_individuals);
+        interned.reserve(2 * num_individuals);
+    }
+
+    // marks the junctions added since the previous chromosome as one
+    // chromosome. If it was added before, the new junctions are dropped again.
+    void close_chromosome() {
+        close_chromosome(hash_chromosome(open_chromosome()));
+    }
+
+    // as above, for a chromosome of which the hash is already known
+    void close_chromosome(uint64_t hash) {
+        if(add_interned(open_chromosome(), hash)) {
+            junctions.resize(open_begin);
+            return;
+        }
+        interned.insert(std::make_pair(hash, spans.size()));
+        spans.push_back(chromosome_span(open_begin, junctions.size()));
+        hashes.push_back(hash);
+        open_begin = junctions.size();
+    }
+
+    // the (cleared) bitset of the last chromosome
+    uint64_t* add_selected() {
+        selected_alleles.resize(selected_alleles.size() + selected_words, 0);
+        return selected(num_chromosomes() - 1);
+    }
+
+    // adds chrom, which is only copied if it was not added before
+    void add_chromosome(const chromosome_view<JUNCTION>& chrom, uint64_t hash) {
+        if(add_interned(chrom, hash)) return;
+        junctions.insert(junctions.end(), chrom.begin(), chrom.end());
+        close_chromosome(hash);
+    }
+
+    void add_chromosome(const chromosome_view<JUNCTION>& chrom) {
+        add_chromosome(chrom, hash_chromosome(chrom));
+    }
+
+    // adds chromosome k again, sharing its junctions
+    void add_shared(size_t k) {
+        spans.push_back(spans[k]);
+        hashes.push_back(hashes[k]);
+    }
+
+    // adds one pair of chromosomes, with several pairs per individual the
+    // pairs of an individual are added one after the other
+    void add_individual(const Fish_t<JUNCTION>& focal) {
+        add_chromosome(focal.chromosome1);
+        add_chromosome(focal.chromosome2);
+    }
+
+    void add_individual(const Population_t<JUNCTION>& other,
+                        size_t individual) {
+        size_t first = other.chromosome_index(individual, 0, 0);
+        for(size_t k = first; k < first + 2 * num_chromosome_pairs; ++k) {
+            add_chromosome(other.chromosome(k), other.hashes[k]);
+        }
+    }
+
+    // adds all individuals of other. Chromosomes are interned again, such
+    // that chromosomes present in both populations are stored once.
+    void append(const Population_t<JUNCTION>& other) {
+        for(size_t k = 0; k < other.num_chromosomes(); ++k) {
+            add_chromosome(other.chromosome(k), other.hashes[k]);
+            selected_alleles.insert(selected_alleles.end(),
+                                    other.selected_alleles.begin() +
+                                        k * other.selected_words,
+                                    other.selected_alleles.begin() +
+                                        (k + 1) * other.selected_words);
+        }
+    }
+
+    Fish_t<JUNCTION> individual(size_t i) const {
+        Fish_t<JUNCTION> focal;
+        focal.chromosome1.assign(chromosome1(i).begin(), chromosome1(i).end());
+        focal.chromosome2.assign(chromosome2(i).begin(), chromosome2(i).end());
+        return focal;
+    }
+
+    void swap(Population_t<JUNCTION>& other) {
+        junctions.swap(other.junctions);
+        spans.swap(other.spans);
+        hashes.swap(other.hashes);
+        selected_alleles.swap(other.selected_alleles);
+        std::swap(selected_words, other.selected_words);
+        std::swap(num_chromosome_pairs, other.num_chromosome_pairs);
+        interned.swap(other.interned);
+        std::swap(open_begin, other.open_begin);
+    }
+
+private:
+    // hash of a chromosome -> the first chromosome added with that hash
+    std::unordered_map< uint64_t, size_t > interned;
+    // start of the junctions of the chromosome that is being added
+    size_t open_begin;
+
+    chromosome_view<JUNCTION> open_chromosome() const {
+        return chromosome_view<JUNCTION>(junctions.data() + open_begin,
+                                         junctions.data() + junctions.size());
+    }
+
+    // adds chrom as a reference to an identical chromosome added before,
+    // returns false if there is none
+    bool add_interned(const chromosome_view<JUNCTION>& chrom, uint64_t hash) {
+        auto found = interned.find(hash);
+        if(found == interned.end()) return false;
+
+        chromosome_span match = spans[found->second];
+        if(match.end - match.begin != chrom.size() ||
+           !std::equal(chrom.begin(), chrom.end(),
+                       junctions.begin() + match.begin)) {
+            return false;
+        }
+        spans.push_back(match);
+        hashes.push_back(hash);
+        return true;
+    }
+};
+
+#endif /* Population_hpp */
@@ -6,6 +6,34 @@
 
 using namespace Rcpp;
 
+// calculate_fst_cpp
+Rcpp::List calculate_fst_cpp(Rcpp::RObject population_1, Rcpp::IntegerVector individuals_1, Rcpp::RObject population_2, Rcpp::IntegerVector individuals_2, Rcpp::NumericVector markers);
+RcppExport SEXP _GenomeAdmixR_calculate_fst_cpp(SEXP population_1SEXP, SEXP individuals_1SEXP, SEXP population_2SEXP, SEXP individuals_2SEXP, SEXP markersSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type population_1(population_1SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type individuals_1(individuals_1SEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type population_2(population_2SEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type individuals_2(individuals_2SEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type markers(markersSEXP);
+    rcpp_result_gen = Rcpp::wrap(calculate_fst_cpp(population_1, individuals_1, population_2, individuals_2, markers));
+    return rcpp_result_gen;
+END_RCPP
+}
+// genotype_population_cpp
+Rcpp::IntegerMatrix genotype_population_cpp(Rcpp::RObject population, Rcpp::NumericVector markers, int num_threads);
+RcppExport SEXP _GenomeAdmixR_genotype_population_cpp(SEXP populationSEXP, SEXP markersSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type population(populationSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type markers(markersSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(genotype_population_cpp(population, markers, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // calculate_allele_spectrum_cpp
 arma::mat calculate_allele_spectrum_cpp(Rcpp::NumericVector input_population, Rcpp::NumericVector markers, bool progress_bar);
 RcppExport SEXP _GenomeAdmixR_calculate_allele_spectrum_cpp(SEXP input_populationSEXP, SEXP markersSEXP, SEXP progress_barSEXP) {
@@ -19,37 +47,184 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// calculate_ld_cpp
+Rcpp::List calculate_ld_cpp(Rcpp::RObject population, Rcpp::NumericVector markers, int num_threads);
+RcppExport SEXP _GenomeAdmixR_calculate_ld_cpp(SEXP populationSEXP, SEXP markersSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type population(populationSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type markers(markersSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(calculate_ld_cpp(population, markers, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// calculate_ld_decay_cpp
+Rcpp::NumericMatrix calculate_ld_decay_cpp(Rcpp::RObject population, Rcpp::NumericVector markers, int number_of_bins, double max_distance, double pair_fraction, int seed, int num_threads);
+RcppExport SEXP _GenomeAdmixR_calculate_ld_decay_cpp(SEXP populationSEXP, SEXP markersSEXP, SEXP number_of_binsSEXP, SEXP max_distanceSEXP, SEXP pair_fractionSEXP, SEXP seedSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type population(populationSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type markers(markersSEXP);
+    Rcpp::traits::input_parameter< int >::type number_of_bins(number_of_binsSEXP);
+    Rcpp::traits::input_parameter< double >::type max_distance(max_distanceSEXP);
+    Rcpp::traits::input_parameter< double >::type pair_fraction(pair_fractionSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(calculate_ld_decay_cpp(population, markers, number_of_bins, max_distance, pair_fraction, seed, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// save_population_cpp
+void save_population_cpp(Rcpp::RObject handle, std::string file_name);
+RcppExport SEXP _GenomeAdmixR_save_population_cpp(SEXP handleSEXP, SEXP file_nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type handle(handleSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file_name(file_nameSEXP);
+    save_population_cpp(handle, file_name);
+    return R_NilValue;
+END_RCPP
+}
+// load_population_cpp
+Rcpp::RObject load_population_cpp(std::string file_name, bool as_handle);
+RcppExport SEXP _GenomeAdmixR_load_population_cpp(SEXP file_nameSEXP, SEXP as_handleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file_name(file_nameSEXP);
+    Rcpp::traits::input_parameter< bool >::type as_handle(as_handleSEXP);
+    rcpp_result_gen = Rcpp::wrap(load_population_cpp(file_name, as_handle));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_population_handle_cpp
+Rcpp::RObject create_population_handle_cpp(Rcpp::List populations);
+RcppExport SEXP _GenomeAdmixR_create_population_handle_cpp(SEXP populationsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type populations(populationsSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_population_handle_cpp(populations));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_population_handle_from_matrix_cpp
+Rcpp::RObject create_population_handle_from_matrix_cpp(Rcpp::List matrices);
+RcppExport SEXP _GenomeAdmixR_create_population_handle_from_matrix_cpp(SEXP matricesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type matrices(matricesSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_population_handle_from_matrix_cpp(matrices));
+    return rcpp_result_gen;
+END_RCPP
+}
+// population_handle_to_list_cpp
+List population_handle_to_list_cpp(Rcpp::RObject handle, Rcpp::IntegerVector individuals);
+RcppExport SEXP _GenomeAdmixR_population_handle_to_list_cpp(SEXP handleSEXP, SEXP individualsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type handle(handleSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type individuals(individualsSEXP);
+    rcpp_result_gen = Rcpp::wrap(population_handle_to_list_cpp(handle, individuals));
+    return rcpp_result_gen;
+END_RCPP
+}
+// population_handle_to_matrix_cpp
+Rcpp::RObject population_handle_to_matrix_cpp(Rcpp::RObject handle);
+RcppExport SEXP _GenomeAdmixR_population_handle_to_matrix_cpp(SEXP handleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type handle(handleSEXP);
+    rcpp_result_gen = Rcpp::wrap(population_handle_to_matrix_cpp(handle));
+    return rcpp_result_gen;
+END_RCPP
+}
+// population_handle_info_cpp
+NumericVector population_handle_info_cpp(Rcpp::RObject handle);
+RcppExport SEXP _GenomeAdmixR_population_handle_info_cpp(SEXP handleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type handle(handleSEXP);
+    rcpp_result_gen = Rcpp::wrap(population_handle_info_cpp(handle));
+    return rcpp_result_gen;
+END_RCPP
+}
 // simulate_cpp
-List simulate_cpp(Rcpp::NumericVector input_population, NumericMatrix select, int pop_size, int number_of_founders, Rcpp::NumericVector starting_proportions, int total_runtime, double morgan, bool progress_bar, bool track_frequency, NumericVector track_markers, bool track_junctions, bool multiplicative_selection, int seed);
-RcppExport SEXP _GenomeAdmixR_simulate_cpp(SEXP input_populationSEXP, SEXP selectSEXP, SEXP pop_sizeSEXP, SEXP number_of_foundersSEXP, SEXP starting_proportionsSEXP, SEXP total_runtimeSEXP, SEXP morganSEXP, SEXP progress_barSEXP, SEXP track_frequencySEXP, SEXP track_markersSEXP, SEXP track_junctionsSEXP, SEXP multiplicative_selectionSEXP, SEXP seedSEXP) {
+List simulate_cpp(Rcpp::RObject input_population, std::string input_file, NumericMatrix select, int pop_size, int number_of_founders, Rcpp::NumericVector starting_proportions, int total_runtime, NumericVector morgan, bool progress_bar, bool track_frequency, NumericVector track_markers, NumericVector marker_chromosomes, NumericVector track_generations, std::string frequency_file, bool track_junctions, bool track_haplotypes, bool multiplicative_selection, bool record_genealogy, bool return_handle, int seed, int fixed_point_bits, int num_threads);
+RcppExport SEXP _GenomeAdmixR_simulate_cpp(SEXP input_populationSEXP, SEXP input_fileSEXP, SEXP selectSEXP, SEXP pop_sizeSEXP, SEXP number_of_foundersSEXP, SEXP starting_proportionsSEXP, SEXP total_runtimeSEXP, SEXP morganSEXP, SEXP progress_barSEXP, SEXP track_frequencySEXP, SEXP track_markersSEXP, SEXP marker_chromosomesSEXP, SEXP track_generationsSEXP, SEXP frequency_fileSEXP, SEXP track_junctionsSEXP, SEXP track_haplotypesSEXP, SEXP multiplicative_selectionSEXP, SEXP record_genealogySEXP, SEXP return_handleSEXP, SEXP seedSEXP, SEXP fixed_point_bitsSEXP, SEXP num_threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type input_population(input_populationSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type input_population(input_populationSEXP);
+    Rcpp::traits::input_parameter< std::string >::type input_file(input_fileSEXP);
     Rcpp::traits::input_parameter< NumericMatrix >::type select(selectSEXP);
     Rcpp::traits::input_parameter< int >::type pop_size(pop_sizeSEXP);
     Rcpp::traits::input_parameter< int >::type number_of_founders(number_of_foundersSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type starting_proportions(starting_proportionsSEXP);
     Rcpp::traits::input_parameter< int >::type total_runtime(total_runtimeSEXP);
-    Rcpp::traits::input_parameter< double >::type morgan(morganSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type morgan(morganSEXP);
     Rcpp::traits::input_parameter< bool >::type progress_bar(progress_barSEXP);
     Rcpp::traits::input_parameter< bool >::type track_frequency(track_frequencySEXP);
     Rcpp::traits::input_parameter< NumericVector >::type track_markers(track_markersSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type marker_chromosomes(marker_chromosomesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type track_generations(track_generationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type frequency_file(frequency_fileSEXP);
     Rcpp::traits::input_parameter< bool >::type track_junctions(track_junctionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type track_haplotypes(track_haplotypesSEXP);
     Rcpp::traits::input_parameter< bool >::type multiplicative_selection(multiplicative_selectionSEXP);
+    Rcpp::traits::input_parameter< bool >::type record_genealogy(record_genealogySEXP);
+    Rcpp::traits::input_parameter< bool >::type return_handle(return_handleSEXP);
     Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
-    rcpp_result_gen = Rcpp::wrap(simulate_cpp(input_population, select, pop_size, number_of_founders, starting_proportions, total_runtime, morgan, progress_bar, track_frequency, track_markers, track_junctions, multiplicative_selection, seed));
+    Rcpp::traits::input_parameter< int >::type fixed_point_bits(fixed_point_bitsSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(simulate_cpp(input_population, input_file, select, pop_size, number_of_founders, starting_proportions, total_runtime, morgan, progress_bar, track_frequency, track_markers, marker_chromosomes, track_generations, frequency_file, track_junctions, track_haplotypes, multiplicative_selection, record_genealogy, return_handle, seed, fixed_point_bits, num_threads));
     return rcpp_result_gen;
 END_RCPP
 }
 // simulate_migration_cpp
-List simulate_migration_cpp(NumericVector input_population_1, NumericVector input_population_2, NumericMatrix select, NumericVector pop_size, NumericMatrix starting_frequencies, int total_runtime, double morgan, bool progress_bar, bool track_frequency, NumericVector track_markers, bool track_junctions, bool multiplicative_selection, double migration_rate, int seed);
-RcppExport SEXP _GenomeAdmixR_simulate_migration_cpp(SEXP input_population_1SEXP, SEXP input_population_2SEXP, SEXP selectSEXP, SEXP pop_sizeSEXP, SEXP starting_frequenciesSEXP, SEXP total_runtimeSEXP, SEXP morganSEXP, SEXP progress_barSEXP, SEXP track_frequencySEXP, SEXP track_markersSEXP, SEXP track_junctionsSEXP, SEXP multiplicative_selectionSEXP, SEXP migration_rateSEXP, SEXP seedSEXP) {
+List simulate_migration_cpp(Rcpp::RObject input_population_1, Rcpp::RObject input_population_2, NumericMatrix select, NumericVector pop_size, NumericMatrix starting_frequencies, int total_runtime, double morgan, bool progress_bar, bool track_frequency, NumericVector track_markers, NumericVector track_generations, std::string frequency_file, bool track_junctions, bool multiplicative_selection, double migration_rate, bool return_handle, int seed, int fixed_point_bits, int num_threads);
+RcppExport SEXP _GenomeAdmixR_simulate_migration_cpp(SEXP input_population_1SEXP, SEXP input_population_2SEXP, SEXP selectSEXP, SEXP pop_sizeSEXP, SEXP starting_frequenciesSEXP, SEXP total_runtimeSEXP, SEXP morganSEXP, SEXP progress_barSEXP, SEXP track_frequencySEXP, SEXP track_markersSEXP, SEXP track_generationsSEXP, SEXP frequency_fileSEXP, SEXP track_junctionsSEXP, SEXP multiplicative_selectionSEXP, SEXP migration_rateSEXP, SEXP return_handleSEXP, SEXP seedSEXP, SEXP fixed_point_bitsSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type input_population_1(input_population_1SEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type input_population_2(input_population_2SEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type select(selectSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type pop_size(pop_sizeSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type starting_frequencies(starting_frequenciesSEXP);
+    Rcpp::traits::input_parameter< int >::type total_runtime(total_runtimeSEXP);
+    Rcpp::traits::input_parameter< double >::type morgan(morganSEXP);
+    Rcpp::traits::input_parameter< bool >::type progress_bar(progress_barSEXP);
+    Rcpp::traits::input_parameter< bool >::type track_frequency(track_frequencySEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type track_markers(track_markersSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type track_generations(track_generationsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type frequency_file(frequency_fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type track_junctions(track_junctionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type multiplicative_selection(multiplicative_selectionSEXP);
+    Rcpp::traits::input_parameter< double >::type migration_rate(migration_rateSEXP);
+    Rcpp::traits::input_parameter< bool >::type return_handle(return_handleSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type fixed_point_bits(fixed_point_bitsSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(simulate_migration_cpp(input_population_1, input_population_2, select, pop_size, starting_frequencies, total_runtime, morgan, progress_bar, track_frequency, track_markers, track_generations, frequency_file, track_junctions, multiplicative_selection, migration_rate, return_handle, seed, fixed_point_bits, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// simulate_migration_until_cpp
+List simulate_migration_until_cpp(Rcpp::RObject input_population_1, Rcpp::RObject input_population_2, NumericMatrix select, NumericVector pop_size, NumericMatrix starting_frequencies, int total_runtime, double morgan, bool progress_bar, bool track_frequency, NumericVector track_markers, NumericVector track_generations, bool track_junctions, bool multiplicative_selection, double migration_rate, int generations_between_update, double critical_fst, int sampled_individuals, int number_of_markers, bool random_markers, bool return_handle, int seed, int fixed_point_bits, int num_threads);
+RcppExport SEXP _GenomeAdmixR_simulate_migration_until_cpp(SEXP input_population_1SEXP, SEXP input_population_2SEXP, SEXP selectSEXP, SEXP pop_sizeSEXP, SEXP starting_frequenciesSEXP, SEXP total_runtimeSEXP, SEXP morganSEXP, SEXP progress_barSEXP, SEXP track_frequencySEXP, SEXP track_markersSEXP, SEXP track_generationsSEXP, SEXP track_junctionsSEXP, SEXP multiplicative_selectionSEXP, SEXP migration_rateSEXP, SEXP generations_between_updateSEXP, SEXP critical_fstSEXP, SEXP sampled_individualsSEXP, SEXP number_of_markersSEXP, SEXP random_markersSEXP, SEXP return_handleSEXP, SEXP seedSEXP, SEXP fixed_point_bitsSEXP, SEXP num_threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< NumericVector >::type input_population_1(input_population_1SEXP);
-    Rcpp::traits::input_parameter< NumericVector >::type input_population_2(input_population_2SEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type input_population_1(input_population_1SEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type input_population_2(input_population_2SEXP);
     Rcpp::traits::input_parameter< NumericMatrix >::type select(selectSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type pop_size(pop_sizeSEXP);
     Rcpp::traits::input_parameter< NumericMatrix >::type starting_frequencies(starting_frequenciesSEXP);
@@ -58,19 +233,56 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type progress_bar(progress_barSEXP);
     Rcpp::traits::input_parameter< bool >::type track_frequency(track_frequencySEXP);
     Rcpp::traits::input_parameter< NumericVector >::type track_markers(track_markersSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type track_generations(track_generationsSEXP);
     Rcpp::traits::input_parameter< bool >::type track_junctions(track_junctionsSEXP);
     Rcpp::traits::input_parameter< bool >::type multiplicative_selection(multiplicative_selectionSEXP);
     Rcpp::traits::input_parameter< double >::type migration_rate(migration_rateSEXP);
+    Rcpp::traits::input_parameter< int >::type generations_between_update(generations_between_updateSEXP);
+    Rcpp::traits::input_parameter< double >::type critical_fst(critical_fstSEXP);
+    Rcpp::traits::input_parameter< int >::type sampled_individuals(sampled_individualsSEXP);
+    Rcpp::traits::input_parameter< int >::type number_of_markers(number_of_markersSEXP);
+    Rcpp::traits::input_parameter< bool >::type random_markers(random_markersSEXP);
+    Rcpp::traits::input_parameter< bool >::type return_handle(return_handleSEXP);
     Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
-    rcpp_result_gen = Rcpp::wrap(simulate_migration_cpp(input_population_1, input_population_2, select, pop_size, starting_frequencies, total_runtime, morgan, progress_bar, track_frequency, track_markers, track_junctions, multiplicative_selection, migration_rate, seed));
+    Rcpp::traits::input_parameter< int >::type fixed_point_bits(fixed_point_bitsSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(simulate_migration_until_cpp(input_population_1, input_population_2, select, pop_size, starting_frequencies, total_runtime, morgan, progress_bar, track_frequency, track_markers, track_generations, track_junctions, multiplicative_selection, migration_rate, generations_between_update, critical_fst, sampled_individuals, number_of_markers, random_markers, return_handle, seed, fixed_point_bits, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// calculate_tajima_d_cpp
+Rcpp::NumericMatrix calculate_tajima_d_cpp(Rcpp::RObject population, Rcpp::IntegerVector individuals, Rcpp::NumericVector markers, double window_size, double window_step);
+RcppExport SEXP _GenomeAdmixR_calculate_tajima_d_cpp(SEXP populationSEXP, SEXP individualsSEXP, SEXP markersSEXP, SEXP window_sizeSEXP, SEXP window_stepSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type population(populationSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type individuals(individualsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type markers(markersSEXP);
+    Rcpp::traits::input_parameter< double >::type window_size(window_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type window_step(window_stepSEXP);
+    rcpp_result_gen = Rcpp::wrap(calculate_tajima_d_cpp(population, individuals, markers, window_size, window_step));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_GenomeAdmixR_calculate_fst_cpp", (DL_FUNC) &_GenomeAdmixR_calculate_fst_cpp, 5},
+    {"_GenomeAdmixR_genotype_population_cpp", (DL_FUNC) &_GenomeAdmixR_genotype_population_cpp, 3},
     {"_GenomeAdmixR_calculate_allele_spectrum_cpp", (DL_FUNC) &_GenomeAdmixR_calculate_allele_spectrum_cpp, 3},
-    {"_GenomeAdmixR_simulate_cpp", (DL_FUNC) &_GenomeAdmixR_simulate_cpp, 13},
-    {"_GenomeAdmixR_simulate_migration_cpp", (DL_FUNC) &_GenomeAdmixR_simulate_migration_cpp, 14},
+    {"_GenomeAdmixR_calculate_ld_cpp", (DL_FUNC) &_GenomeAdmixR_calculate_ld_cpp, 3},
+    {"_GenomeAdmixR_calculate_ld_decay_cpp", (DL_FUNC) &_GenomeAdmixR_calculate_ld_decay_cpp, 7},
+    {"_GenomeAdmixR_save_population_cpp", (DL_FUNC) &_GenomeAdmixR_save_population_cpp, 2},
+    {"_GenomeAdmixR_load_population_cpp", (DL_FUNC) &_GenomeAdmixR_load_population_cpp, 2},
+    {"_GenomeAdmixR_create_population_handle_cpp", (DL_FUNC) &_GenomeAdmixR_create_population_handle_cpp, 1},
+    {"_GenomeAdmixR_create_population_handle_from_matrix_cpp", (DL_FUNC) &_GenomeAdmixR_create_population_handle_from_matrix_cpp, 1},
+    {"_GenomeAdmixR_population_handle_to_list_cpp", (DL_FUNC) &_GenomeAdmixR_population_handle_to_list_cpp, 2},
+    {"_GenomeAdmixR_population_handle_to_matrix_cpp", (DL_FUNC) &_GenomeAdmixR_population_handle_to_matrix_cpp, 1},
+    {"_GenomeAdmixR_population_handle_info_cpp", (DL_FUNC) &_GenomeAdmixR_population_handle_info_cpp, 1},
+    {"_GenomeAdmixR_simulate_cpp", (DL_FUNC) &_GenomeAdmixR_simulate_cpp, 22},
+    {"_GenomeAdmixR_simulate_migration_cpp", (DL_FUNC) &_GenomeAdmixR_simulate_migration_cpp, 19},
+    {"_GenomeAdmixR_simulate_migration_until_cpp", (DL_FUNC) &_GenomeAdmixR_simulate_migration_until_cpp, 23},
+    {"_GenomeAdmixR_calculate_tajima_d_cpp", (DL_FUNC) &_GenomeAdmixR_calculate_tajima_d_cpp, 5},
     {NULL, NULL, 0}
 };
 
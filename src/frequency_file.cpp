@@ -0,0 +1,113 @@
+//
+//  frequency_file.cpp
+//
+//
+
+#include "frequency_file.h"
+#include <cstring>
+#include <RcppArmadillo.h>
+
+namespace {
+
+void append_int32(std::vector< char >& buffer, int32_t x) {
+    uint32_t u = static_cast<uint32_t>(x);
+    for(int i = 0; i < 4; ++i) {
+        buffer.push_back(static_cast<char>((u >> (8 * i)) & 0xFF));
+    }
+}
+
+void append_double(std::vector< char >& buffer, double x) {
+    uint64_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    for(int i = 0; i < 8; ++i) {
+        buffer.push_back(static_cast<char>((u >> (8 * i)) & 0xFF));
+    }
+}
+
+}
+
+frequency_writer::frequency_writer(const std::string& file_name,
+                                   const std::vector<double>& locations,
+                                   const std::vector<int>& chromosomes,
+                                   const std::vector<int>& labels,
+                                   int num_populations) :
+    out(file_name.c_str(), std::ios::binary | std::ios::trunc) {
+    if(!out) {
+        Rcpp::stop("could not open frequency file " + file_name);
+    }
+
+    std::vector< char > header;
+    header.insert(header.end(), {'G', 'A', 'F', 'Q'});
+    append_int32(header, 1);
+    append_int32(header, locations.size());
+    append_int32(header, labels.size());
+    append_int32(header, num_populations);
+    for(size_t i = 0; i < locations.size(); ++i) {
+        append_double(header, locations[i]);
+    }
+    for(size_t i = 0; i < chromosomes.size(); ++i) {
+        append_int32(header, chromosomes[i] + 1);
+    }
+    for(size_t i = 0; i < labels.size(); ++i) {
+        append_int32(header, labels[i]);
+    }
+    out.write(header.data(), header.size());
+}
+
+void frequency_writer::write(int t,
+                             const std::vector< int32_t >& num_chromosomes,
+                             const std::vector< double >& counts) {
+    std::vector< char > buffer;
+    buffer.reserve(4 * (1 + num_chromosomes.size() + counts.size()));
+    append_int32(buffer, t);
+    for(size_t i = 0; i < num_chromosomes.size(); ++i) {
+        append_int32(buffer, num_chromosomes[i]);
+    }
+    for(size_t i = 0; i < counts.size(); ++i) {
+        append_int32(buffer, static_cast<int32_t>(counts[i]));
+    }
+    out.write(buffer.data(), buffer.size());
+    if(!out) {
+        Rcpp::stop("could not write to frequency file");
+    }
+}
+
+template <typename JUNCTION>
+void write_frequencies(frequency_writer& file,
+                       const marker_plan_t<JUNCTION>& plan,
+                       int t,
+                       const Population_t<JUNCTION>& pop) {
+    std::vector< double > counts(plan.num_rows(), 0.0);
+    count_ancestry(pop, plan, counts.data());
+    file.write(t, std::vector< int32_t >(1, 2 * pop.size()), counts);
+}
+
+template <typename JUNCTION>
+void write_frequencies(frequency_writer& file,
+                       const marker_plan_t<JUNCTION>& plan,
+                       int t,
+                       const Population_t<JUNCTION>& pop_1,
+                       const Population_t<JUNCTION>& pop_2) {
+    size_t num_rows = plan.num_rows();
+    std::vector< double > counts(2 * num_rows, 0.0);
+    count_ancestry(pop_1, plan, counts.data());
+    count_ancestry(pop_2, plan, counts.data() + num_rows);
+
+    std::vector< int32_t > num_chromosomes;
+    num_chromosomes.push_back(2 * pop_1.size());
+    num_chromosomes.push_back(2 * pop_2.size());
+    file.write(t, num_chromosomes, counts);
+}
+
+#define INSTANTIATE_FREQUENCY_FILE(JUNCTION)                                   \
+template void write_frequencies(frequency_writer&,                             \
+                                const marker_plan_t<JUNCTION>&, int,           \
+                                const Population_t<JUNCTION>&);                \
+template void write_frequencies(frequency_writer&,                             \
+                                const marker_plan_t<JUNCTION>&, int,           \
+                                const Population_t<JUNCTION>&,                 \
+                                const Population_t<JUNCTION>&);
+
+INSTANTIATE_FREQUENCY_FILE(junction)
+INSTANTIATE_FREQUENCY_FILE(junction_fixed32)
+INSTANTIATE_FREQUENCY_FILE(junction_fixed64)
@@ -0,0 +1,64 @@
+//
+//  frequency_file.h
+//
+//
+//  Streaming output of allele frequencies over time, as an alternative to
+//  keeping the frequencies of every generation in memory. The file starts
+//  with a header holding the markers and ancestry labels, such that every
+//  generation only adds its integer counts:
+//
+//    header   "GAFQ", int32 version, int32 markers M, int32 ancestries A,
+//             int32 populations P, double location[M],
+//             int32 chromosome[M] (starting at 1), int32 ancestry[A]
+//    record   int32 time, int32 chromosomes[P],
+//             int32 count[P][M][A]
+//
+//  All values are little endian. Records have a fixed size, such that a
+//  reader can seek to the generations it needs.
+//
+
+#ifndef frequency_file_hpp
+#define frequency_file_hpp
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include "Population.h"
+#include "helper_functions.h"
+
+class frequency_writer {
+public:
+    frequency_writer(const std::string& file_name,
+                     const std::vector<double>& locations,
+                     const std::vector<int>& chromosomes,
+                     const std::vector<int>& labels,
+                     int num_populations);
+
+    // appends generation t, where counts holds the counts of every
+    // population, marker and ancestry, and num_chromosomes the number of
+    // chromosomes in every population
+    void write(int t,
+               const std::vector< int32_t >& num_chromosomes,
+               const std::vector< double >& counts);
+
+private:
+    std::ofstream out;
+};
+
+// appends the ancestry counts of pop in generation t to file
+template <typename JUNCTION>
+void write_frequencies(frequency_writer& file,
+                       const marker_plan_t<JUNCTION>& plan,
+                       int t,
+                       const Population_t<JUNCTION>& pop);
+
+// as above, for two populations
+template <typename JUNCTION>
+void write_frequencies(frequency_writer& file,
+                       const marker_plan_t<JUNCTION>& plan,
+                       int t,
+                       const Population_t<JUNCTION>& pop_1,
+                       const Population_t<JUNCTION>& pop_2);
+
+#endif /* frequency_file_hpp */
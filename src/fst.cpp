@@ -0,0 +1,318 @@
+//
+//  fst.cpp
+//
+//
+
+#include "fst.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "random_functions.h"
+#include "population_handle.h"
+
+namespace {
+
+// chromosome of the streams used to sample individuals and markers, after
+// the parents of both populations were drawn
+const uint32_t fst_stream = 3;
+
+// adds the components of allele frequencies count / (2 n) and heterozygote
+// frequencies het / n in r populations
+void add_components(const std::vector< double >& n,
+                    const double* count,
+                    const double* het,
+                    size_t num_alleles,
+                    wc_components& output) {
+    size_t r = 0;
+    double n_total = 0.0;
+    double n_squared = 0.0;
+    for(size_t p = 0; p < n.size(); ++p) {
+        if(n[p] <= 0) continue;
+        r++;
+        n_total += n[p];
+        n_squared += n[p] * n[p];
+    }
+    if(r < 2) return;
+
+    double n_bar = n_total / r;
+    double n_c = (n_total - n_squared / n_total) / (r - 1);
+    if(n_bar <= 1.0) return;
+
+    for(size_t u = 0; u < num_alleles; ++u) {
+        double p_bar = 0.0;
+        double h_bar = 0.0;
+        for(size_t p = 0; p < n.size(); ++p) {
+            p_bar += count[p * num_alleles + u];
+            h_bar += het[p * num_alleles + u];
+        }
+        p_bar /= 2 * n_total;
+        h_bar /= n_total;
+
+        double s2 = 0.0;
+        for(size_t p = 0; p < n.size(); ++p) {
+            if(n[p] <= 0) continue;
+            double d = count[p * num_alleles + u] / (2 * n[p]) - p_bar;
+            s2 += n[p] * d * d;
+        }
+        s2 /= (r - 1) * n_bar;
+
+        double within = p_bar * (1 - p_bar) - (r - 1) * s2 / r;
+        output.a += n_bar / n_c * (s2 - (within - h_bar / 4) / (n_bar - 1));
+        output.b += n_bar / (n_bar - 1) *
+                    (within - (2 * n_bar - 1) * h_bar / (4 * n_bar));
+        output.c += h_bar / 2;
+    }
+}
+
+}
+
+std::vector< wc_components > weir_cockerham(const std::vector< int >& genotypes,
+                                            const std::vector< size_t >& sample_sizes,
+                                            size_t num_markers) {
+    std::vector< wc_components > output(num_markers);
+    size_t num_populations = sample_sizes.size();
+    size_t stride = 2 * num_markers;
+
+    std::vector< int > alleles;
+    std::vector< size_t > index(2);
+    std::vector< double > n(num_populations);
+    std::vector< double > count;
+    std::vector< double > het;
+
+    for(size_t m = 0; m < num_markers; ++m) {
+        // the alleles present at marker m, in order of appearance
+        alleles.clear();
+        const int* g = genotypes.data() + 2 * m;
+        for(size_t p = 0, i = 0; p < num_populations; ++p) {
+            for(size_t j = 0; j < sample_sizes[p]; ++j, ++i) {
+                const int* genotype = g + i * stride;
+                if(genotype[0] < 0 || genotype[1] < 0) continue;
+                for(int h = 0; h < 2; ++h) {
+                    if(std::find(alleles.begin(), alleles.end(),
+                                 genotype[h]) == alleles.end()) {
+                        alleles.push_back(genotype[h]);
+                    }
+                }
+            }
+        }
+        if(alleles.size() < 2) continue;
+
+        size_t num_alleles = alleles.size();
+        count.assign(num_populations * num_alleles, 0.0);
+        het.assign(num_populations * num_alleles, 0.0);
+        std::fill(n.begin(), n.end(), 0.0);
+        for(size_t p = 0, i = 0; p < num_populations; ++p) {
+            for(size_t j = 0; j < sample_sizes[p]; ++j, ++i) {
+                const int* genotype = g + i * stride;
+                if(genotype[0] < 0 || genotype[1] < 0) continue;
+                for(int h = 0; h < 2; ++h) {
+                    index[h] = std::find(alleles.begin(), alleles.end(),
+                                         genotype[h]) - alleles.begin();
+                    count[p * num_alleles + index[h]] += 1.0;
+                }
+                if(index[0] != index[1]) {
+                    het[p * num_alleles + index[0]] += 1.0;
+                    het[p * num_alleles + index[1]] += 1.0;
+                }
+                n[p] += 1.0;
+            }
+        }
+        add_components(n, count.data(), het.data(), num_alleles, output[m]);
+    }
+    return output;
+}
+
+template <typename JUNCTION>
+std::vector< wc_components > weir_cockerham(const Population_t<JUNCTION>& pop_1,
+                                            const std::vector< size_t >& individuals_1,
+                                            const Population_t<JUNCTION>& pop_2,
+                                            const std::vector< size_t >& individuals_2,
+                                            const marker_plan_t<JUNCTION>& plan) {
+    size_t num_markers = plan.locations.size();
+    std::vector< size_t > sample_sizes;
+    sample_sizes.push_back(individuals_1.size());
+    sample_sizes.push_back(individuals_2.size());
+    std::vector< int > genotypes((individuals_1.size() + individuals_2.size()) *
+                                 2 * num_markers);
+    int* output = genotypes.data();
+    for(auto it = individuals_1.begin(); it != individuals_1.end(); ++it) {
+        genotype_individual(pop_1, *it, plan, output);
+        output += 2 * num_markers;
+    }
+    for(auto it = individuals_2.begin(); it != individuals_2.end(); ++it) {
+        genotype_individual(pop_2, *it, plan, output);
+        output += 2 * num_markers;
+    }
+    return weir_cockerham(genotypes, sample_sizes, num_markers);
+}
+
+double weir_cockerham_fst(const std::vector< wc_components >& components) {
+    double between = 0.0;
+    double total = 0.0;
+    for(auto it = components.begin(); it != components.end(); ++it) {
+        between += it->a;
+        total += it->a + it->b + it->c;
+    }
+    if(total == 0.0) return std::numeric_limits<double>::quiet_NaN();
+    return between / total;
+}
+
+double weir_cockerham_fst(const wc_components& components) {
+    return weir_cockerham_fst(std::vector< wc_components >(1, components));
+}
+
+fst_monitor_t::fst_monitor_t(int between_update, double critical,
+                             int individuals, int markers, bool random,
+                             bool verbose_output) :
+    generations_between_update(between_update),
+    critical_fst(critical),
+    sampled_individuals(individuals),
+    number_of_markers(markers),
+    random_markers(random),
+    verbose(verbose_output) {
+    if(generations_between_update < 1) {
+        Rcpp::stop("generations_between_update has to be at least 1");
+    }
+    if(sampled_individuals < 2) {
+        Rcpp::stop("at least two individuals have to be sampled to estimate Fst");
+    }
+    if(number_of_markers < 1) {
+        Rcpp::stop("at least one marker is needed to estimate Fst");
+    }
+    if(verbose) Rcpp::Rcout << "Number of Generations\tFST\n";
+}
+
+bool fst_monitor_t::is_due(int generations_simulated, int total_runtime) const {
+    return generations_simulated % generations_between_update == 0 ||
+           generations_simulated == total_runtime;
+}
+
+template <typename JUNCTION>
+bool fst_monitor_t::update(const Population_t<JUNCTION>& pop_1,
+                           const Population_t<JUNCTION>& pop_2,
+                           int t) {
+    if(sampled_individuals > (int)pop_1.size() ||
+       sampled_individuals > (int)pop_2.size()) {
+        Rcpp::stop("can not sample more individuals than there are in the population");
+    }
+    set_stream(t, parent_stream, fst_stream);
+
+    Rcpp::NumericVector markers(number_of_markers);
+    for(int i = 0; i < number_of_markers; ++i) {
+        if(random_markers) {
+            markers[i] = uniform();
+        } else if(number_of_markers == 1) {
+            markers[i] = 1e-9;
+        } else {
+            markers[i] = 1e-9 + i * (1 - 2e-9) / (number_of_markers - 1);
+        }
+    }
+    marker_plan_t<JUNCTION> plan(markers, std::vector<int>(), std::vector<int>(),
+                                 pop_1.num_chromosome_pairs);
+
+    std::vector< size_t > individuals[2];
+    const Population_t<JUNCTION>* pops[2] = {&pop_1, &pop_2};
+    for(int p = 0; p < 2; ++p) {
+        // the first sampled_individuals of a partial Fisher-Yates shuffle
+        std::vector< size_t > order(pops[p]->size());
+        for(size_t i = 0; i < order.size(); ++i) order[i] = i;
+        for(int i = 0; i < sampled_individuals; ++i) {
+            std::swap(order[i], order[i + random_number(order.size() - i)]);
+        }
+        individuals[p].assign(order.begin(), order.begin() + sampled_individuals);
+    }
+
+    double estimate = weir_cockerham_fst(weir_cockerham(pop_1, individuals[0],
+                                                        pop_2, individuals[1],
+                                                        plan));
+    generations.push_back(t + 1);
+    fst.push_back(estimate);
+    if(verbose) {
+        Rcpp::Rcout << t + 1 << "\t" << estimate << "\n";
+        R_FlushConsole();
+    }
+    return estimate >= critical_fst;
+}
+
+namespace {
+
+template <typename JUNCTION>
+Rcpp::List calculate_fst_impl(const population_handle& handle_1,
+                              const std::vector< size_t >& individuals_1,
+                              const population_handle& handle_2,
+                              const std::vector< size_t >& individuals_2,
+                              const Rcpp::NumericVector& markers) {
+    // populations kept in another junction type are converted
+    Population_t<JUNCTION> converted_1, converted_2;
+    const Population_t<JUNCTION>* pop_1 = handle_1.find<JUNCTION>();
+    if(!pop_1) {
+        converted_1 = handle_1.get<JUNCTION>();
+        pop_1 = &converted_1;
+    }
+    const Population_t<JUNCTION>* pop_2 = handle_2.find<JUNCTION>();
+    if(!pop_2) {
+        converted_2 = handle_2.get<JUNCTION>();
+        pop_2 = &converted_2;
+    }
+
+    marker_plan_t<JUNCTION> plan(markers, std::vector<int>(), std::vector<int>(),
+                                 pop_1->num_chromosome_pairs);
+    std::vector< wc_components > components = weir_cockerham(*pop_1, individuals_1,
+                                                             *pop_2, individuals_2,
+                                                             plan);
+    Rcpp::NumericVector per_marker(components.size());
+    for(size_t m = 0; m < components.size(); ++m) {
+        per_marker[m] = weir_cockerham_fst(components[m]);
+    }
+    return Rcpp::List::create(Rcpp::Named("fst") = weir_cockerham_fst(components),
+                              Rcpp::Named("per_marker") = per_marker);
+}
+
+std::vector< size_t > get_individuals(const Rcpp::IntegerVector& individuals,
+                                      const population_handle& handle) {
+    std::vector< size_t > output;
+    for(int i = 0; i < individuals.size(); ++i) {
+        if(individuals[i] < 0 || individuals[i] >= (int)handle.size()) {
+            Rcpp::stop("individual not in population");
+        }
+        output.push_back(individuals[i]);
+    }
+    return output;
+}
+
+}
+
+// [[Rcpp::export]]
+Rcpp::List calculate_fst_cpp(Rcpp::RObject population_1,
+                             Rcpp::IntegerVector individuals_1,
+                             Rcpp::RObject population_2,
+                             Rcpp::IntegerVector individuals_2,
+                             Rcpp::NumericVector markers) {
+    population_ptr handle_1 = get_population_handle(population_1);
+    population_ptr handle_2 = get_population_handle(population_2);
+    std::vector< size_t > sample_1 = get_individuals(individuals_1, *handle_1);
+    std::vector< size_t > sample_2 = get_individuals(individuals_2, *handle_2);
+
+    switch(handle_1->fixed_point_bits) {
+        case 32: return calculate_fst_impl<junction_fixed32>(*handle_1, sample_1,
+                                                             *handle_2, sample_2,
+                                                             markers);
+        case 64: return calculate_fst_impl<junction_fixed64>(*handle_1, sample_1,
+                                                             *handle_2, sample_2,
+                                                             markers);
+    }
+    return calculate_fst_impl<junction>(*handle_1, sample_1,
+                                        *handle_2, sample_2, markers);
+}
+
+#define INSTANTIATE_FST(JUNCTION)                                              \
+template std::vector< wc_components > weir_cockerham(                          \
+    const Population_t<JUNCTION>&, const std::vector< size_t >&,               \
+    const Population_t<JUNCTION>&, const std::vector< size_t >&,               \
+    const marker_plan_t<JUNCTION>&);                                           \
+template bool fst_monitor_t::update(const Population_t<JUNCTION>&,             \
+                                    const Population_t<JUNCTION>&, int);
+
+INSTANTIATE_FST(junction)
+INSTANTIATE_FST(junction_fixed32)
+INSTANTIATE_FST(junction_fixed64)
@@ -0,0 +1,77 @@
+//
+//  fst.h
+//
+//
+//  Weir & Cockerham (1984) estimate of Fst from diploid ancestry genotypes,
+//  where every ancestry is an allele. Components are computed per marker and
+//  summed over the alleles at that marker; the multilocus estimate is the
+//  ratio of the components summed over markers, as in hierfstat::wc.
+//
+
+#ifndef fst_hpp
+#define fst_hpp
+
+#include <vector>
+#include "Population.h"
+#include "helper_functions.h"
+
+struct wc_components {
+    double a;  // between populations
+    double b;  // between individuals within populations
+    double c;  // within individuals
+
+    wc_components() : a(0.0), b(0.0), c(0.0) {}
+};
+
+// genotypes holds the individuals of population 0, followed by those of
+// population 1, etc., sample_sizes[p] individuals for population p. Every
+// individual has 2 * num_markers ancestries, laid out as written by
+// genotype_individual. Individuals that miss an ancestry at a marker (-1) are
+// left out at that marker.
+std::vector< wc_components > weir_cockerham(const std::vector< int >& genotypes,
+                                            const std::vector< size_t >& sample_sizes,
+                                            size_t num_markers);
+
+// as above, for the listed individuals of pop_1 and pop_2, genotyped at the
+// markers of plan
+template <typename JUNCTION>
+std::vector< wc_components > weir_cockerham(const Population_t<JUNCTION>& pop_1,
+                                            const std::vector< size_t >& individuals_1,
+                                            const Population_t<JUNCTION>& pop_2,
+                                            const std::vector< size_t >& individuals_2,
+                                            const marker_plan_t<JUNCTION>& plan);
+
+// the multilocus estimate, NaN if no marker is polymorphic
+double weir_cockerham_fst(const std::vector< wc_components >& components);
+
+// the estimate of a single marker
+double weir_cockerham_fst(const wc_components& components);
+
+// Fst between two simulated populations, estimated every
+// generations_between_update generations from sampled individuals and
+// markers. The simulation stops once the estimate reaches critical_fst.
+struct fst_monitor_t {
+    int generations_between_update;
+    double critical_fst;
+    int sampled_individuals;
+    int number_of_markers;
+    bool random_markers;
+    bool verbose;
+    // the number of generations simulated at every estimate, and the estimate
+    std::vector< int > generations;
+    std::vector< double > fst;
+
+    fst_monitor_t(int between_update, double critical, int individuals,
+                  int markers, bool random, bool verbose_output);
+
+    bool is_due(int generations_simulated, int total_runtime) const;
+
+    // estimates Fst after generation t, using draws that only depend on the
+    // seed and t. Returns true if critical_fst is reached.
+    template <typename JUNCTION>
+    bool update(const Population_t<JUNCTION>& pop_1,
+                const Population_t<JUNCTION>& pop_2,
+                int t);
+};
+
+#endif /* fst_hpp */
@@ -0,0 +1,81 @@
+//
+//  genotype.cpp
+//
+//
+//  The ancestry of every chromosome of a population at a set of markers.
+//  Markers are sorted once, after which every chromosome is genotyped in a
+//  single walk along its junctions.
+//
+
+#include <vector>
+#include <algorithm>
+#include "population_handle.h"
+#include "helper_functions.h"
+
+namespace {
+
+template <typename JUNCTION>
+Rcpp::IntegerMatrix genotype_population(const population_handle& handle,
+                                        const Rcpp::NumericVector& markers,
+                                        int num_threads) {
+    Population_t<JUNCTION> converted;
+    const Population_t<JUNCTION>* pop = handle.find<JUNCTION>();
+    if(!pop) {
+        converted = handle.get<JUNCTION>();
+        pop = &converted;
+    }
+    marker_plan_t<JUNCTION> plan(markers, std::vector<int>(), std::vector<int>(),
+                                 pop->num_chromosome_pairs);
+
+    // per individual, the ancestries as written by genotype_individual
+    int num_individuals = pop->size();
+    size_t num_markers = markers.size();
+    std::vector< int > genotypes(num_individuals * 2 * num_markers);
+
+#pragma omp parallel for num_threads(std::max(1, num_threads)) schedule(static)
+    for(int i = 0; i < num_individuals; ++i) {
+        genotype_individual(*pop, i, plan,
+                            genotypes.data() + i * 2 * num_markers);
+    }
+
+    // a row per chromosome, individual i having rows 2i and 2i + 1. Blocks
+    // of individuals are transposed at once, to stay in cache.
+    size_t num_rows = 2 * num_individuals;
+    Rcpp::IntegerMatrix output(num_rows, num_markers);
+    int* column_major = output.begin();
+    const int block_size = 64;
+    int num_blocks = (num_individuals + block_size - 1) / block_size;
+
+#pragma omp parallel for num_threads(std::max(1, num_threads)) schedule(static)
+    for(int block = 0; block < num_blocks; ++block) {
+        int end = std::min(num_individuals, (block + 1) * block_size);
+        for(size_t m = 0; m < num_markers; ++m) {
+            int* column = column_major + m * num_rows;
+            for(int i = block * block_size; i < end; ++i) {
+                const int* genotype = genotypes.data() + i * 2 * num_markers + 2 * m;
+                column[2 * i] = genotype[0] < 0 ? NA_INTEGER : genotype[0];
+                column[2 * i + 1] = genotype[1] < 0 ? NA_INTEGER : genotype[1];
+            }
+        }
+    }
+    return output;
+}
+
+}
+
+// the ancestry of both chromosomes of every individual at the markers, NA
+// at or beyond the end of the chromosome. Markers lie on the first
+// chromosome pair.
+// [[Rcpp::export]]
+Rcpp::IntegerMatrix genotype_population_cpp(Rcpp::RObject population,
+                                            Rcpp::NumericVector markers,
+                                            int num_threads) {
+    population_ptr handle = get_population_handle(population);
+    switch(handle->fixed_point_bits) {
+        case 32: return genotype_population<junction_fixed32>(*handle, markers,
+                                                              num_threads);
+        case 64: return genotype_population<junction_fixed64>(*handle, markers,
+                                                              num_threads);
+    }
+    return genotype_population<junction>(*handle, markers, num_threads);
+}
@@ -7,32 +7,33 @@
 
 #include "helper_functions.h"
 #include <vector>
-
-bool matching_chromosomes(const std::vector< junction >& v1,
-                          const std::vector< junction >& v2)
-{
-    if(v1.size() != v2.size()) {
-        return false;
-    }
-    for(int i = 0; i < v1.size(); ++i) {
-        if(v1[i] != v2[i]) {
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+template <typename JUNCTION>
+bool is_fixed(const Population_t<JUNCTION>& pop) {
+
+    // every chromosome is compared with the same chromosome of the first
+    // individual. Identical chromosomes have identical hashes, which rules out
+    // almost all populations that are not fixed without looking at their
+    // junctions
+    for(size_t k = 1; k < pop.hashes.size(); ++k) {
+        if(pop.hashes[k] != pop.hashes[2 * pop.pair_of(k)]) {
             return false;
         }
     }
-    return true;
-}
-
-bool is_fixed(const std::vector< Fish >& v) {
 
-    if(!matching_chromosomes(v[0].chromosome1, v[0].chromosome2)) {
-        return false;
-    }
+    // identical chromosomes usually share their junctions
+    for(size_t k = 1; k < pop.num_chromosomes(); ++k) {
+        size_t reference = 2 * pop.pair_of(k);
+        if(pop.spans[k].begin == pop.spans[reference].begin) continue;
 
-    for(auto it = v.begin(); it != v.end(); ++it) {
-        if(!matching_chromosomes((*it).chromosome1, v[0].chromosome1)) {
-            return false;
-        }
-        if(!matching_chromosomes((*it).chromosome1, (*it).chromosome2)) {
+        chromosome_view<JUNCTION> first = pop.chromosome(reference);
+        chromosome_view<JUNCTION> focal = pop.chromosome(k);
+        if(focal.size() != first.size() ||
+           !std::equal(first.begin(), first.end(), focal.begin())) {
             return false;
         }
     }
@@ -48,7 +49,8 @@ int find_index(const std::vector<int>& v, int value) {
 }
 
 
-void update_founder_labels(const std::vector<junction> chrom,
+template <typename JUNCTION>
+void update_founder_labels(const std::vector<JUNCTION> chrom,
                            std::vector<int>& founder_labels) {
     for(auto i = chrom.begin(); i != chrom.end(); ++i) {
         if(founder_labels.empty()) {
@@ -62,181 +64,154 @@ void update_founder_labels(const std::vector<junction> chrom,
     return;
 }
 
-arma::mat update_frequency_tibble(const std::vector< Fish >& v,
-                                  double m,
-                                  const std::vector<int>& founder_labels,
-                                  int t) {
-
-    int num_alleles = founder_labels.size();
-    arma::mat allele_matrix(num_alleles, 4);
-    for(int i = 0; i < num_alleles; ++i) {
-        allele_matrix(i, 0) = t;
-        allele_matrix(i, 1) = m;
-        allele_matrix(i, 2) = founder_labels[i];
-        allele_matrix(i, 3) = 0;
-    }
-
-   for(auto it = v.begin(); it != v.end(); ++it) {
-       for(auto i = ((*it).chromosome1.begin()+1); i != (*it).chromosome1.end(); ++i) {
-           if((*i).pos > m) {
-               int local_anc = (*(i-1)).right;
-               int index = find_index(founder_labels, local_anc);
-               allele_matrix(index, 3)++;
-               break;
-           }
-       }
-
-       for(auto i = ((*it).chromosome2.begin()+1); i != (*it).chromosome2.end(); ++i) {
-           if((*i).pos > m) {
-               int local_anc = (*(i-1)).right;
-               int index = find_index(founder_labels, local_anc);
-               allele_matrix(index, 3)++;
-               break;
-           }
-       }
-   }
-
-   for(int i = 0; i < num_alleles; ++i) {
-       allele_matrix(i, 3) *= 1.0 / (2 * v.size());
-   }
-
-   return(allele_matrix);
-}
-
-
-arma::mat update_all_frequencies_tibble(const std::vector< Fish >& pop,
+template <typename JUNCTION>
+arma::mat update_all_frequencies_tibble(const Population_t<JUNCTION>& pop,
                                         const NumericVector& markers,
+                                        const std::vector<int>& marker_chromosomes,
                                         const std::vector<int>& founder_labels,
                                         int t) {
-
-   // Rcout << "this is update_all_frequencies_tibble\n"; R_FlushConsole();
-    int number_of_alleles = founder_labels.size();
-  //  Rcout << number_of_alleles << "\n";
-    arma::mat output(markers.size() * number_of_alleles, 4);
-
-    for(int i = 0; i < markers.size(); ++i) {
-        //Rcout << "collect local_mat\n";
-        arma::mat local_mat = update_frequency_tibble(pop,
-                                                 markers[i],
-                                                 founder_labels,
-                                                 t);
-       // now we have a (markers x alleles) x 3 tibble, e.g. [loc, anc, freq]
-       // and we have to put that in the right place in the output matrix
-        //Rcout << "now we feed local mat to output:\n";
-        int start = i * number_of_alleles;
-        int end = start + number_of_alleles;
-        for(int j = start; j < end; ++j) {
-           for(int k = 0; k < 4; ++k) {
-              // Rcout << j << "\t" << k << "\t" << j - start << "\n";
-               output(j, k) = local_mat(j - start, k);
-           }
-        }
-    }
-   return(output);
+    marker_plan_t<JUNCTION> plan(markers, marker_chromosomes, founder_labels,
+                                 pop.num_chromosome_pairs);
+    // with several chromosomes, the chromosome is added as fifth column
+    arma::mat output(plan.num_rows(), pop.num_chromosome_pairs > 1 ? 5 : 4);
+    record_frequencies(pop, plan, t, output, 0);
+    return(output);
 }
 
-
-
-arma::mat record_frequencies_pop(const std::vector< Fish >& pop,
-                                 const NumericVector& markers,
-                                 const std::vector<int>& founder_labels,
+template <typename JUNCTION>
+void record_frequencies_dual_pop(const Population_t<JUNCTION>& pop_1,
+                                 const Population_t<JUNCTION>& pop_2,
+                                 const marker_plan_t<JUNCTION>& plan,
                                  int t,
-                                 int pop_indicator) {
-    // Rcout << "start record_frequencies_pop\n"; R_FlushConsole();
-     int number_of_alleles = founder_labels.size();
-     arma::mat output(markers.size() * number_of_alleles, 5);
-
-     for(int i = 0; i < markers.size(); ++i) {
-         // Rcout << "collect local_mat\n";
-         arma::mat local_mat = update_frequency_tibble(pop,
-                                                       markers[i],
-                                                       founder_labels,
-                                                       t);
-         // now we have a (markers x alleles) x 5 tibble, e.g. [loc, anc, freq, pop]
-         // and we have to put that in the right place in the output matrix
-         // Rcout << "now we feed local mat to output:\n";
-         int start = i * number_of_alleles;
-         int end = start + number_of_alleles;
-         for(int j = start; j < end; ++j) {
-             for(int k = 0; k < 4; ++k) {
-                 //Rcout << j << "\t" << k << "\t" << j - start << "\n";
-                 //Rcout << "writing to: " << output(j, k) << "\n";
-                 //Rcout << "writing from: " << local_mat(j - start, k) << "\n";
-                 output(j, k) = local_mat(j - start, k);
-             }
-             output(j, 4) = pop_indicator;
-         }
-     }
-    // Rcout << "end record_frequencies_pop\n"; R_FlushConsole();
-     return(output);
+                                 arma::mat& output,
+                                 size_t first_row) {
+    // the fifth column indicates the population
+    size_t num_rows = plan.num_rows();
+    record_frequencies(pop_1, plan, t, output, first_row);
+    record_frequencies(pop_2, plan, t, output, first_row + num_rows);
+    for(size_t r = 0; r < num_rows; ++r) {
+        output(first_row + r, 4) = 1;
+        output(first_row + num_rows + r, 4) = 2;
+    }
 }
 
-arma::mat update_all_frequencies_tibble_dual_pop(const std::vector< Fish >& pop_1,
-                                                 const std::vector< Fish >& pop_2,
+template <typename JUNCTION>
+arma::mat update_all_frequencies_tibble_dual_pop(const Population_t<JUNCTION>& pop_1,
+                                                 const Population_t<JUNCTION>& pop_2,
                                                  const NumericVector& markers,
                                                  const std::vector<int>& founder_labels,
                                                  int t) {
-    //Rcout << "start update_all_frequencies_tibble_dual_pop\n"; R_FlushConsole();
-    arma::mat output_1 = record_frequencies_pop(pop_1, markers, founder_labels, t, 1);
-    //Rcout << "starting on output_2\n";
-    arma::mat output_2 = record_frequencies_pop(pop_2, markers, founder_labels, t, 2);
-
-    //Rcout << "joining by column\n";
-    arma::mat output = arma::join_cols(output_1, output_2);
-    //Rcout << "end update_all_frequencies_tibble_dual_pop\n"; R_FlushConsole();
+    marker_plan_t<JUNCTION> plan(markers, std::vector<int>(), founder_labels, 1);
+    arma::mat output(2 * plan.num_rows(), 5);
+    if(plan.num_rows() > 0) {
+        record_frequencies_dual_pop(pop_1, pop_2, plan, t, output, 0);
+    }
     return(output);
 }
 
-double calc_mean_junctions(const std::vector< Fish> & pop) {
+template <typename JUNCTION>
+double calc_mean_junctions(const Population_t<JUNCTION>& pop) {
 
-    double mean_junctions = 0.0;
-    for(auto it = pop.begin(); it != pop.end(); ++it) {
-        mean_junctions += (*it).chromosome1.size() - 2; // start and end don't count
-        mean_junctions += (*it).chromosome2.size() - 2;
-    }
-    mean_junctions *= 1.0 / (pop.size() * 2); // diploid
+    // start and end don't count
+    double mean_junctions = pop.num_junctions() - 2 * pop.num_chromosomes();
+    mean_junctions *= 1.0 / pop.num_chromosomes();
 
     return(mean_junctions);
 }
 
-int draw_prop_fitness(const std::vector<double>& fitness,
-                      double maxFitness) {
+template <typename JUNCTION>
+int count_haplotypes(const Population_t<JUNCTION>& pop) {
+    // identical chromosomes of different pairs are different haplotypes
+    std::vector< std::pair< size_t, uint64_t > > hashes;
+    hashes.reserve(pop.num_chromosomes());
+    for(size_t k = 0; k < pop.num_chromosomes(); ++k) {
+        hashes.push_back(std::make_pair(pop.pair_of(k), pop.hashes[k]));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+}
+
+void alias_table::build(const std::vector<double>& fitness, bool log_scale) {
 
-    if(maxFitness <= 0.0) {
-        Rcout << "maxFitness = " << maxFitness << "\n";
-        Rcpp::stop("Cannot draw fitness if maxFitness <= 0");
-        return(-1);
+    int n = fitness.size();
+    std::vector< double > weights(fitness);
+    if(log_scale) {
+        // relative to the fittest individual, such that many loci with a
+        // small effect do not underflow
+        double max_fitness = -std::numeric_limits<double>::infinity();
+        for(int i = 0; i < n; ++i) {
+            if(fitness[i] > max_fitness) max_fitness = fitness[i];
+        }
+        for(int i = 0; i < n; ++i) {
+            weights[i] = std::exp(fitness[i] - max_fitness);
+        }
     }
 
-    if(maxFitness > 10000.0) {
-        Rcout << "maxFitness = " << maxFitness << "\n";
-        Rcpp::stop("It appears maxfitness has encountered a memory access violation\n");
-        return(-1);
+    double total_fitness = 0.0;
+    int num_viable = 0;
+    for(int i = 0; i < n; ++i) {
+        // individuals with fitness <= 0 are never drawn
+        if(weights[i] > 0.0) {
+            total_fitness += weights[i];
+            num_viable++;
+        }
     }
 
-    for(int i = 0; i < 1e6; ++i) {
-        int index = random_number(fitness.size());
-        double prob = 1.0 * fitness[index] / maxFitness;
-        if(uniform() < prob) {
-            return index;
+    if(num_viable < 2) {
+        Rcout << "individuals with fitness > 0: " << num_viable << "\n";
+        Rcpp::stop("Cannot draw two parents if less than two individuals have fitness > 0");
+    }
+
+    // Vose's construction: every entry holds its own (scaled) probability,
+    // and the remainder is covered by an entry with surplus probability
+    prob.resize(n);
+    alias.resize(n);
+    std::vector< int > small, large;
+    for(int i = 0; i < n; ++i) {
+        prob[i] = weights[i] > 0.0 ? weights[i] * n / total_fitness : 0.0;
+        alias[i] = i;
+        if(prob[i] < 1.0) {
+            small.push_back(i);
+        } else {
+            large.push_back(i);
         }
     }
-    Rcout << maxFitness << "\n";
-    Rcpp::stop("ERROR!Couldn't pick proportional to fitness");
-    return -1;
+
+    while(!small.empty() && !large.empty()) {
+        int focal = small.back();
+        small.pop_back();
+        int donor = large.back();
+        alias[focal] = donor;
+        prob[donor] = (prob[donor] + prob[focal]) - 1.0;
+        if(prob[donor] < 1.0) {
+            large.pop_back();
+            small.push_back(donor);
+        }
+    }
+    // left-overs only differ from 1.0 by rounding
+    for(auto i = small.begin(); i != small.end(); ++i) prob[*i] = 1.0;
+    for(auto i = large.begin(); i != large.end(); ++i) prob[*i] = 1.0;
 }
 
+int alias_table::draw() const {
+    int index = random_number(prob.size());
+    if(uniform() < prob[index]) {
+        return index;
+    }
+    return alias[index];
+}
 
-std::vector< Fish > convert_NumericVector_to_fishVector(const NumericVector v) {
-    std::vector< Fish > output;
+template <typename JUNCTION>
+std::vector< Fish_t<JUNCTION> > convert_NumericVector_to_fishVector(const NumericVector v) {
+    std::vector< Fish_t<JUNCTION> > output;
 
-    Fish temp;
+    Fish_t<JUNCTION> temp;
     int indic_chrom = 1;
     bool add_indiv = false;
 
     for(int i = 0; i < v.size(); i += 2) {
-        junction temp_j;
-        temp_j.pos = v[i];
+        JUNCTION temp_j;
+        temp_j.pos = JUNCTION::encode(v[i]);
         temp_j.right = v[i+1];
 
         if(indic_chrom == 1) {
@@ -265,25 +240,25 @@ std::vector< Fish > convert_NumericVector_to_fishVector(const NumericVector v) {
     return(output);
 }
 
-List convert_to_list(const std::vector<Fish>& v) {
-    int list_size = (int)v.size();
-    List output(list_size);
-
-    for(int i = 0; i < v.size(); ++i) {
+template <typename JUNCTION>
+NumericMatrix convert_chromosome(const chromosome_view<JUNCTION>& chrom) {
+    NumericMatrix output(chrom.size(), 2); // nrow = number of junctions, ncol = 2
+    for(size_t j = 0; j < chrom.size(); ++j) {
+        output(j, 0) = JUNCTION::decode(chrom[j].pos);
+        output(j, 1) = chrom[j].right;
+    }
+    return output;
+}
 
-        Fish focal = v[i];
+template <typename JUNCTION>
+List convert_to_list(const Population_t<JUNCTION>& pop, size_t pair) {
+    int list_size = (int)pop.size();
+    List output(list_size);
 
-        NumericMatrix chrom1(focal.chromosome1.size(), 2); // nrow = number of junctions, ncol = 2
-        for(int j = 0; j < focal.chromosome1.size(); ++j) {
-            chrom1(j, 0) = focal.chromosome1[j].pos;
-            chrom1(j, 1) = focal.chromosome1[j].right;
-        }
+    for(int i = 0; i < list_size; ++i) {
 
-        NumericMatrix chrom2(focal.chromosome2.size(), 2); // nrow = number of junctions, ncol = 2
-        for(int j = 0; j < focal.chromosome2.size(); ++j) {
-            chrom2(j, 0) = focal.chromosome2[j].pos;
-            chrom2(j, 1) = focal.chromosome2[j].right;
-        }
+        NumericMatrix chrom1 = convert_chromosome(pop.chromosome1(i, pair));
+        NumericMatrix chrom2 = convert_chromosome(pop.chromosome2(i, pair));
 
         List toAdd = List::create( Named("chromosome1") = chrom1,
                                    Named("chromosome2") = chrom2
@@ -295,65 +270,361 @@ List convert_to_list(const std::vector<Fish>& v) {
     return output;
 }
 
-double calculate_fitness(const Fish& focal,
-                         const NumericMatrix& select,
-                         bool multiplicative_selection) {
-
-    int number_of_markers = select.nrow();
-    std::vector< int > num_alleles(number_of_markers, 0);
-
-    int focal_marker = 0;
-    double pos = select(focal_marker, 0);
-    double anc = select(focal_marker, 4);
-    // loc aa  Aa  AA ancestor
-    //  0  1   2  3  4
-
-    for(auto it = (focal.chromosome1.begin()+1); it != focal.chromosome1.end(); ++it) {
-        if((*it).pos > pos) {
-            if((*(it-1)).right == anc) num_alleles[focal_marker]++;
-            focal_marker++;
-            if(focal_marker >= number_of_markers) {
-                break;
+template <typename JUNCTION>
+List convert_to_list(const Population_t<JUNCTION>& pop) {
+    if(pop.num_chromosome_pairs == 1) return convert_to_list(pop, 0);
+
+    List output(pop.num_chromosome_pairs);
+    for(size_t c = 0; c < pop.num_chromosome_pairs; ++c) {
+        output(c) = convert_to_list(pop, c);
+    }
+    return output;
+}
+
+// chromosome of an individual as returned to R, a matrix with a row per
+// junction holding its position and ancestry
+template <typename JUNCTION>
+void add_matrix_chromosome(Population_t<JUNCTION>& pop,
+                           const NumericMatrix& chrom) {
+    std::vector< JUNCTION > junctions(chrom.nrow());
+    for(int j = 0; j < chrom.nrow(); ++j) {
+        junctions[j] = JUNCTION(JUNCTION::encode(chrom(j, 0)), chrom(j, 1));
+    }
+    pop.add_chromosome(chromosome_view<JUNCTION>(junctions));
+}
+
+template <typename JUNCTION>
+Population_t<JUNCTION> convert_from_list(List populations) {
+    Population_t<JUNCTION> pop;
+    pop.num_chromosome_pairs = populations.size();
+    List first = populations[0];
+    pop.reserve(first.size());
+
+    for(int i = 0; i < first.size(); ++i) {
+        for(int c = 0; c < populations.size(); ++c) {
+            List population = populations[c];
+            if(population.size() != first.size()) {
+                Rcpp::stop("all chromosomes need the same number of individuals");
             }
-            pos = select(focal_marker, 0);
-            anc = select(focal_marker, 4);
+            List individual = population[i];
+            NumericMatrix chrom1 = individual["chromosome1"];
+            NumericMatrix chrom2 = individual["chromosome2"];
+            add_matrix_chromosome(pop, chrom1);
+            add_matrix_chromosome(pop, chrom2);
         }
-        if(anc < 0) break; // these entries are only for tracking alleles over time, not for selection calculation
     }
+    return pop;
+}
 
-    focal_marker = 0;
-    pos = select(focal_marker, 0);
-    anc = select(focal_marker, 4);
+template <typename JUNCTION>
+NumericMatrix convert_to_matrix(const Population_t<JUNCTION>& pop, size_t pair) {
+    size_t num_rows = 0;
+    for(size_t i = 0; i < pop.size(); ++i) {
+        num_rows += pop.chromosome1(i, pair).size() +
+                    pop.chromosome2(i, pair).size();
+    }
 
-    for(auto it = (focal.chromosome2.begin()+1); it != focal.chromosome2.end(); ++it) {
-        if((*it).pos > pos) {
-            if((*(it-1)).right == anc) num_alleles[focal_marker]++;
-            focal_marker++;
-            if(focal_marker >= number_of_markers) {
-                break;
+    NumericMatrix output(num_rows, 4);
+    size_t row = 0;
+    for(size_t i = 0; i < pop.size(); ++i) {
+        for(int h = 0; h < 2; ++h) {
+            chromosome_view<JUNCTION> chrom =
+                pop.chromosome(pop.chromosome_index(i, pair, h));
+            for(size_t j = 0; j < chrom.size(); ++j, ++row) {
+                output(row, 0) = i + 1;
+                output(row, 1) = h + 1;
+                output(row, 2) = JUNCTION::decode(chrom[j].pos);
+                output(row, 3) = chrom[j].right;
             }
-            pos = select(focal_marker, 0);
-            anc = select(focal_marker, 4);
         }
-        if(anc < 0) break; // these entries are only for tracking alleles over time, not for selection calculation
     }
+    return output;
+}
 
-    double fitness = 0.0;
-    if (multiplicative_selection) fitness = 1.0;
-    for(int i = 0; i < num_alleles.size(); ++i) {
+template <typename JUNCTION>
+Population_t<JUNCTION> convert_from_matrix(List matrices) {
+    size_t num_pairs = matrices.size();
+    std::vector< NumericMatrix > pairs;
+    for(size_t c = 0; c < num_pairs; ++c) {
+        NumericMatrix m = matrices[c];
+        if(m.ncol() != 4) {
+            Rcpp::stop("a population matrix has four columns");
+        }
+        pairs.push_back(m);
+    }
+
+    Population_t<JUNCTION> pop;
+    pop.num_chromosome_pairs = num_pairs;
+    // the next row of every matrix
+    std::vector< int > row(num_pairs, 0);
+    std::vector< JUNCTION > chrom;
+    for(int i = 1; row[0] < pairs[0].nrow(); ++i) {
+        for(size_t c = 0; c < num_pairs; ++c) {
+            const NumericMatrix& m = pairs[c];
+            for(int h = 1; h <= 2; ++h) {
+                chrom.clear();
+                while(row[c] < m.nrow() && m(row[c], 0) == i &&
+                      m(row[c], 1) == h) {
+                    chrom.push_back(JUNCTION(JUNCTION::encode(m(row[c], 2)),
+                                             m(row[c], 3)));
+                    row[c]++;
+                }
+                if(chrom.empty()) {
+                    Rcpp::stop("rows of a population matrix have to be ordered by individual and chromosome");
+                }
+                pop.add_chromosome(chromosome_view<JUNCTION>(chrom));
+            }
+        }
+    }
+    for(size_t c = 1; c < num_pairs; ++c) {
+        if(row[c] != pairs[c].nrow()) {
+            Rcpp::stop("all chromosomes need the same number of individuals");
+        }
+    }
+    return pop;
+}
+
+template <typename JUNCTION>
+selection_plan_t<JUNCTION>::selection_plan_t(const NumericMatrix& select,
+                                             bool multiplicative_selection,
+                                             size_t num_chromosome_pairs) :
+    multiplicative(multiplicative_selection),
+    first_locus(num_chromosome_pairs + 1, 0) {
+
+    // loc aa  Aa  AA ancestor chromosome
+    //  0  1   2  3  4        5
+    if(select.ncol() < 5) return;
+
+    std::vector< int > loci;
+    std::vector< int > pair(select.nrow(), 0);
+    for(int i = 0; i < select.nrow(); ++i) {
         if(select(i, 4) < 0) break; // these entries are only for tracking alleles over time, not for selection calculation
+        if(select.ncol() > 5) {
+            pair[i] = select(i, 5) - 1;
+            if(pair[i] < 0 || pair[i] >= (int)num_chromosome_pairs) {
+                Rcpp::stop("selected locus on a chromosome that does not exist");
+            }
+        }
+        loci.push_back(i);
+    }
+    std::stable_sort(loci.begin(), loci.end(), [&](int a, int b) {
+        if(pair[a] != pair[b]) return pair[a] < pair[b];
+        return select(a, 0) < select(b, 0);
+    });
+
+    for(auto it = loci.begin(); it != loci.end(); ++it) {
+        first_locus[pair[*it] + 1]++;
+        positions.push_back(JUNCTION::encode(select(*it, 0)));
+        ancestors.push_back(select(*it, 4));
+        for(int j = 1; j <= 3; ++j) {
+            double w = select(*it, j);
+            fitness.push_back(multiplicative ? std::log(w) : w);
+        }
+    }
+    for(size_t c = 0; c < num_chromosome_pairs; ++c) {
+        first_locus[c + 1] += first_locus[c];
+    }
+}
+
+// index of the junction that starts the ancestry block containing pos,
+// galloping forward from junction from, which starts at or before pos.
+template <typename JUNCTION>
+inline size_t find_block(const chromosome_view<JUNCTION>& chrom,
+                         size_t from,
+                         typename JUNCTION::position_type pos) {
+    size_t lo = from;
+    size_t step = 1;
+    size_t hi = lo + step;
+    while(hi < chrom.size() && chrom[hi].pos <= pos) {
+        lo = hi;
+        step *= 2;
+        hi = lo + step;
+    }
+    if(hi > chrom.size()) hi = chrom.size();
 
-        int fitness_index = 1 + num_alleles[i];
-        if(multiplicative_selection) {
-            fitness *= select(i, fitness_index);
+    while(hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(chrom[mid].pos <= pos) {
+            lo = mid;
         } else {
-            fitness += select(i, fitness_index);
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+template <typename JUNCTION>
+void find_selected_alleles(const chromosome_view<JUNCTION>& chrom,
+                           const selection_plan_t<JUNCTION>& plan,
+                           size_t pair,
+                           uint64_t* selected) {
+    size_t block = 0;
+    for(size_t i = plan.first_locus[pair]; i < plan.first_locus[pair + 1]; ++i) {
+        block = find_block(chrom, block, plan.positions[i]);
+        // loci at or beyond the end of the chromosome do not carry the allele
+        if(block + 1 < chrom.size() && chrom[block].right == plan.ancestors[i]) {
+            selected[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+template <typename JUNCTION>
+void find_selected_alleles(Population_t<JUNCTION>& pop,
+                           const selection_plan_t<JUNCTION>& plan) {
+    pop.selected_words = plan.num_words();
+    pop.selected_alleles.assign(pop.num_chromosomes() * pop.selected_words, 0);
+    for(size_t k = 0; k < pop.num_chromosomes(); ++k) {
+        find_selected_alleles(pop.chromosome(k), plan, pop.pair_of(k),
+                              pop.selected(k));
+    }
+}
+
+template <typename JUNCTION>
+double calculate_fitness(const Population_t<JUNCTION>& pop,
+                         size_t individual,
+                         const selection_plan_t<JUNCTION>& plan) {
+
+    double fitness = 0.0;
+    for(size_t c = 0; c < pop.num_chromosome_pairs; ++c) {
+        const uint64_t* selected1 = pop.selected(pop.chromosome_index(individual, c, 0));
+        const uint64_t* selected2 = pop.selected(pop.chromosome_index(individual, c, 1));
+
+        for(size_t i = plan.first_locus[c]; i < plan.first_locus[c + 1]; ++i) {
+            int num_alleles = ((selected1[i / 64] >> (i % 64)) & 1) +
+                              ((selected2[i / 64] >> (i % 64)) & 1);
+            fitness += plan.fitness[3 * i + num_alleles];
         }
     }
 
     return(fitness);
 }
 
+template <typename JUNCTION>
+marker_plan_t<JUNCTION>::marker_plan_t(const NumericVector& markers,
+                                       const std::vector<int>& marker_chromosomes,
+                                       const std::vector<int>& founder_labels,
+                                       size_t num_chromosome_pairs) :
+    locations(markers.begin(), markers.end()),
+    labels(founder_labels),
+    first_marker(num_chromosome_pairs + 1, 0) {
+
+    for(size_t i = 0; i < locations.size(); ++i) {
+        chromosomes.push_back(marker_chromosomes.empty() ? 0 : marker_chromosomes[i]);
+    }
+
+    std::vector< size_t > order(locations.size());
+    for(size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if(chromosomes[a] != chromosomes[b]) return chromosomes[a] < chromosomes[b];
+        return locations[a] < locations[b];
+    });
+
+    for(auto it = order.begin(); it != order.end(); ++it) {
+        positions.push_back(JUNCTION::encode(locations[*it]));
+        marker.push_back(*it);
+        first_marker[chromosomes[*it] + 1]++;
+    }
+    for(size_t c = 0; c < num_chromosome_pairs; ++c) {
+        first_marker[c + 1] += first_marker[c];
+    }
+
+    int max_label = -1;
+    for(auto it = labels.begin(); it != labels.end(); ++it) {
+        max_label = std::max(max_label, *it);
+    }
+    column.assign(max_label + 1, -1);
+    for(size_t j = 0; j < labels.size(); ++j) {
+        if(labels[j] >= 0) column[labels[j]] = j;
+    }
+}
+
+template <typename JUNCTION>
+void count_ancestry(const Population_t<JUNCTION>& pop,
+                    const marker_plan_t<JUNCTION>& plan,
+                    double* counts) {
+    size_t num_alleles = plan.labels.size();
+    int num_labels = plan.column.size();
+
+    // chromosomes that share their junctions carry the same ancestry, they
+    // are walked once and counted as often as they occur
+    std::vector< size_t > distinct;
+    std::vector< double > multiplicity;
+    std::unordered_map< size_t, size_t > seen;
+    seen.reserve(pop.num_chromosomes());
+    for(size_t k = 0; k < pop.num_chromosomes(); ++k) {
+        size_t key = pop.spans[k].begin * pop.num_chromosome_pairs + pop.pair_of(k);
+        auto found = seen.insert(std::make_pair(key, distinct.size()));
+        if(found.second) {
+            distinct.push_back(k);
+            multiplicity.push_back(1.0);
+        } else {
+            multiplicity[found.first->second] += 1.0;
+        }
+    }
+
+    for(size_t d = 0; d < distinct.size(); ++d) {
+        size_t pair = pop.pair_of(distinct[d]);
+        chromosome_view<JUNCTION> chrom = pop.chromosome(distinct[d]);
+        size_t block = 0;
+        for(size_t i = plan.first_marker[pair]; i < plan.first_marker[pair + 1]; ++i) {
+            block = find_block(chrom, block, plan.positions[i]);
+            // markers at or beyond the end of the chromosome are not counted
+            if(block + 1 >= chrom.size()) break;
+            int label = chrom[block].right;
+            if(label < 0 || label >= num_labels || plan.column[label] < 0) continue;
+            counts[plan.marker[i] * num_alleles + plan.column[label]] += multiplicity[d];
+        }
+    }
+}
+
+template <typename JUNCTION>
+void genotype_individual(const Population_t<JUNCTION>& pop,
+                         size_t individual,
+                         const marker_plan_t<JUNCTION>& plan,
+                         int* output) {
+    for(size_t pair = 0; pair < pop.num_chromosome_pairs; ++pair) {
+        for(size_t h = 0; h < 2; ++h) {
+            chromosome_view<JUNCTION> chrom =
+                pop.chromosome(pop.chromosome_index(individual, pair, h));
+            size_t block = 0;
+            for(size_t i = plan.first_marker[pair]; i < plan.first_marker[pair + 1]; ++i) {
+                block = find_block(chrom, block, plan.positions[i]);
+                output[2 * plan.marker[i] + h] =
+                    block + 1 < chrom.size() ? chrom[block].right : -1;
+            }
+        }
+    }
+}
+
+template <typename JUNCTION>
+void record_frequencies(const Population_t<JUNCTION>& pop,
+                        const marker_plan_t<JUNCTION>& plan,
+                        int t,
+                        arma::mat& output,
+                        size_t first_row) {
+    size_t num_alleles = plan.labels.size();
+    size_t num_rows = plan.num_rows();
+    if(num_rows == 0) return;
+
+    for(size_t i = 0; i < plan.locations.size(); ++i) {
+        for(size_t j = 0; j < num_alleles; ++j) {
+            size_t row = first_row + i * num_alleles + j;
+            output(row, 0) = t;
+            output(row, 1) = plan.locations[i];
+            output(row, 2) = plan.labels[j];
+            if(pop.num_chromosome_pairs > 1) output(row, 4) = plan.chromosomes[i] + 1;
+        }
+    }
+
+    // the rows of a column are contiguous, the counts go straight into the
+    // frequency column
+    double* frequency = output.colptr(3) + first_row;
+    std::fill(frequency, frequency + num_rows, 0.0);
+    count_ancestry(pop, plan, frequency);
+    double scale = 1.0 / (2 * pop.size());
+    for(size_t r = 0; r < num_rows; ++r) frequency[r] *= scale;
+}
+
 int draw_random_founder(const NumericVector& v) {
     double r = uniform();
     for(int i = 0; i < v.size(); ++i) {
@@ -372,7 +643,7 @@ arma::mat calculate_allele_spectrum_cpp(Rcpp::NumericVector input_population,
 {
     std::vector< Fish > Pop;
 
-    Pop = convert_NumericVector_to_fishVector(input_population);
+    Pop = convert_NumericVector_to_fishVector<junction>(input_population);
     std::vector<int> founder_labels;
     for(auto it = Pop.begin(); it != Pop.end(); ++it) {
         update_founder_labels((*it).chromosome1, founder_labels);
@@ -380,7 +651,56 @@ arma::mat calculate_allele_spectrum_cpp(Rcpp::NumericVector input_population,
     }
     //Rcout << "number of alleles: " << founder_labels.size() << "\n";
 
-    arma::mat frequencies = update_all_frequencies_tibble(Pop, markers, founder_labels, 0);
+    arma::mat frequencies = update_all_frequencies_tibble(Population_t<junction>(Pop),
+                                                          markers,
+                                                          std::vector<int>(),
+                                                          founder_labels, 0);
 
     return frequencies;
-}
\ No newline at end of file
+}
+
+#define INSTANTIATE_HELPER_FUNCTIONS(JUNCTION)                                  \
+template bool is_fixed(const Population_t<JUNCTION>&);                         \
+template double calc_mean_junctions(const Population_t<JUNCTION>&);            \
+template int count_haplotypes(const Population_t<JUNCTION>&);                  \
+template std::vector< Fish_t<JUNCTION> >                                       \
+    convert_NumericVector_to_fishVector<JUNCTION>(const NumericVector);        \
+template List convert_to_list(const Population_t<JUNCTION>&);                  \
+template List convert_to_list(const Population_t<JUNCTION>&, size_t);          \
+template Population_t<JUNCTION> convert_from_list(List);                       \
+template NumericMatrix convert_to_matrix(const Population_t<JUNCTION>&,        \
+                                         size_t);                              \
+template Population_t<JUNCTION> convert_from_matrix(List);                     \
+template struct selection_plan_t<JUNCTION>;                                    \
+template double calculate_fitness(const Population_t<JUNCTION>&, size_t,       \
+                                  const selection_plan_t<JUNCTION>&);          \
+template void find_selected_alleles(const chromosome_view<JUNCTION>&,         \
+                                    const selection_plan_t<JUNCTION>&,         \
+                                    size_t, uint64_t*);                                \
+template void find_selected_alleles(Population_t<JUNCTION>&,                   \
+                                    const selection_plan_t<JUNCTION>&);        \
+template void update_founder_labels(const std::vector<JUNCTION>,               \
+                                    std::vector<int>&);                        \
+template struct marker_plan_t<JUNCTION>;                                       \
+template void count_ancestry(const Population_t<JUNCTION>&,                    \
+                             const marker_plan_t<JUNCTION>&, double*);         \
+template void genotype_individual(const Population_t<JUNCTION>&, size_t,        \
+                                  const marker_plan_t<JUNCTION>&, int*);       \
+template void record_frequencies(const Population_t<JUNCTION>&,                \
+                                 const marker_plan_t<JUNCTION>&, int,          \
+                                 arma::mat&, size_t);                          \
+template void record_frequencies_dual_pop(const Population_t<JUNCTION>&,       \
+                                          const Population_t<JUNCTION>&,       \
+                                          const marker_plan_t<JUNCTION>&, int, \
+                                          arma::mat&, size_t);                 \
+template arma::mat update_all_frequencies_tibble(                              \
+    const Population_t<JUNCTION>&, const NumericVector&,                       \
+    const std::vector<int>&, const std::vector<int>&, int);                                             \
+template arma::mat update_all_frequencies_tibble_dual_pop(                     \
+    const Population_t<JUNCTION>&,                                             \
+    const Population_t<JUNCTION>&, const NumericVector&,                       \
+    const std::vector<int>&, int);
+
+INSTANTIATE_HELPER_FUNCTIONS(junction)
+INSTANTIATE_HELPER_FUNCTIONS(junction_fixed32)
+INSTANTIATE_HELPER_FUNCTIONS(junction_fixed64)
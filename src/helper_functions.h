@@ -10,6 +10,7 @@
 
 #include <vector>
 #include "Fish.h"
+#include "Population.h"
 #include "random_functions.h"
 #include <RcppArmadillo.h>
 // [[Rcpp::depends("RcppArmadillo")]]
@@ -18,10 +19,8 @@ using namespace Rcpp;
 
 // bool verify_individual_cpp(const Fish& Nemo);
 // bool verify_pop_cpp(const std::vector< Fish >& pop);
-bool matching_chromosomes(const std::vector< junction >& v1,
-                          const std::vector< junction >& v2);
-
-bool is_fixed(const std::vector< Fish >& v);
+template <typename JUNCTION>
+bool is_fixed(const Population_t<JUNCTION>& pop);
 
 NumericVector update_frequency(const std::vector< Fish >& v,
                                double m,
@@ -31,35 +30,179 @@ arma::mat update_all_frequencies(const std::vector< Fish >& pop,
                                  const NumericVector& markers,
                                  int number_of_founders);
 
-double calc_mean_junctions(const std::vector< Fish> & pop);
-
-int draw_prop_fitness(const std::vector<double>& fitness,
-                      double maxFitness);
-
-std::vector< Fish > convert_NumericVector_to_fishVector(const NumericVector v);
-
-List convert_to_list(const std::vector<Fish>& v);
-
-double calculate_fitness(const Fish& focal,
-                         const NumericMatrix& select,
-                         bool multiplicative_selection);
+template <typename JUNCTION>
+double calc_mean_junctions(const Population_t<JUNCTION>& pop);
+
+// number of distinct chromosomes (haplotypes) in the population, as judged
+// by their hashes
+template <typename JUNCTION>
+int count_haplotypes(const Population_t<JUNCTION>& pop);
+
+// Draws individuals proportional to their fitness in O(1) per draw, using
+// Walker's alias method. The table is built once per generation.
+class alias_table {
+public:
+    // fitness is on log scale for multiplicative selection
+    void build(const std::vector<double>& fitness, bool log_scale);
+    int draw() const;
+
+private:
+    std::vector< double > prob;
+    std::vector< int > alias;
+};
+
+template <typename JUNCTION>
+std::vector< Fish_t<JUNCTION> > convert_NumericVector_to_fishVector(const NumericVector v);
+
+// a list of individuals, or with several chromosomes a list with such a list
+// for every chromosome
+template <typename JUNCTION>
+List convert_to_list(const Population_t<JUNCTION>& pop);
+
+// the individuals of pop, with chromosome pair only
+template <typename JUNCTION>
+List convert_to_list(const Population_t<JUNCTION>& pop, size_t pair);
+
+// the inverse of convert_to_list, from a list with a list of individuals for
+// every chromosome pair of the genome
+template <typename JUNCTION>
+Population_t<JUNCTION> convert_from_list(List populations);
+
+// chromosome pair of pop as a single matrix with a row per junction and
+// columns individual (starting at 1), chromosome (1 or 2), position and
+// ancestry
+template <typename JUNCTION>
+NumericMatrix convert_to_matrix(const Population_t<JUNCTION>& pop, size_t pair);
+
+// the inverse of convert_to_matrix, from a list with a matrix for every
+// chromosome pair of the genome
+template <typename JUNCTION>
+Population_t<JUNCTION> convert_from_matrix(List matrices);
+
+// The selection matrix compiled once per run: loci sorted by chromosome and
+// position, with the ancestry under selection and the fitness of carrying 0,
+// 1 or 2 copies. An optional sixth column of the matrix holds the chromosome
+// (starting at 1) of a locus.
+// For multiplicative selection, fitness is stored and summed as logarithm,
+// such that many loci do not underflow.
+template <typename JUNCTION>
+struct selection_plan_t {
+    std::vector< typename JUNCTION::position_type > positions;
+    std::vector< int > ancestors;
+    std::vector< double > fitness; // aa, Aa, AA per locus
+    bool multiplicative;
+    // the loci on chromosome pair c are [first_locus[c], first_locus[c + 1])
+    std::vector< size_t > first_locus;
+
+    selection_plan_t(const NumericMatrix& select,
+                     bool multiplicative_selection,
+                     size_t num_chromosome_pairs = 1);
+
+    // words in the bitset of selected alleles of a chromosome
+    size_t num_words() const { return (positions.size() + 63) / 64; }
+};
+
+// sets the bits of the loci at which chrom, a chromosome of pair, carries
+// the selected ancestry
+template <typename JUNCTION>
+void find_selected_alleles(const chromosome_view<JUNCTION>& chrom,
+                           const selection_plan_t<JUNCTION>& plan,
+                           size_t pair,
+                           uint64_t* selected);
+
+// (re)computes the selected alleles of all chromosomes of pop
+template <typename JUNCTION>
+void find_selected_alleles(Population_t<JUNCTION>& pop,
+                           const selection_plan_t<JUNCTION>& plan);
+
+// fitness on the scale of the plan, e.g. the log of fitness for
+// multiplicative selection, using the selected alleles of the individual
+template <typename JUNCTION>
+double calculate_fitness(const Population_t<JUNCTION>& pop,
+                         size_t individual,
+                         const selection_plan_t<JUNCTION>& plan);
 
 int draw_random_founder(const NumericVector& v);
-void update_founder_labels(const std::vector<junction> chrom,
-                           std::vector<int>& founder_labels);
 
-arma::mat update_frequency_tibble(const std::vector< Fish >& v,
-                                  double m,
-                                  const std::vector<int>& founder_labels,
-                                  int t);
+template <typename JUNCTION>
+void update_founder_labels(const std::vector<JUNCTION> chrom,
+                           std::vector<int>& founder_labels);
 
-arma::mat update_all_frequencies_tibble(const std::vector< Fish >& pop,
+// The tracked markers compiled once per run: markers sorted by chromosome and
+// position, such that all markers of a chromosome are resolved in a single
+// walk along its junctions, and a dense table from ancestry label to the
+// index of that label in founder_labels.
+template <typename JUNCTION>
+struct marker_plan_t {
+    // in the order given
+    std::vector< double > locations;
+    std::vector< int > chromosomes;
+    std::vector< int > labels;
+    // sorted, with the index of the marker in the order given
+    std::vector< typename JUNCTION::position_type > positions;
+    std::vector< size_t > marker;
+    // the markers on chromosome pair c are [first_marker[c], first_marker[c + 1])
+    std::vector< size_t > first_marker;
+    // column[label] is the index of label in labels, or -1
+    std::vector< int > column;
+
+    marker_plan_t(const NumericVector& markers,
+                  const std::vector<int>& marker_chromosomes,
+                  const std::vector<int>& founder_labels,
+                  size_t num_chromosome_pairs);
+
+    // rows in a frequency table, one per marker and ancestry
+    size_t num_rows() const { return locations.size() * labels.size(); }
+};
+
+// adds to counts[i * labels + j] the number of chromosomes in pop that carry
+// ancestry labels[j] at marker i
+template <typename JUNCTION>
+void count_ancestry(const Population_t<JUNCTION>& pop,
+                    const marker_plan_t<JUNCTION>& plan,
+                    double* counts);
+
+// writes the ancestry of chromosome h (0 or 1) of every pair of individual i
+// at marker m to output[2 * m + h], or -1 for markers at or beyond the end of
+// the chromosome
+template <typename JUNCTION>
+void genotype_individual(const Population_t<JUNCTION>& pop,
+                         size_t individual,
+                         const marker_plan_t<JUNCTION>& plan,
+                         int* output);
+
+// writes the frequency of every ancestry at every marker in generation t to
+// rows first_row, first_row + 1, ... of output, as time, location, ancestor,
+// frequency and, with several chromosomes, the chromosome
+template <typename JUNCTION>
+void record_frequencies(const Population_t<JUNCTION>& pop,
+                        const marker_plan_t<JUNCTION>& plan,
+                        int t,
+                        arma::mat& output,
+                        size_t first_row);
+
+// as above, for pop_1 followed by pop_2, with the population in the fifth
+// column
+template <typename JUNCTION>
+void record_frequencies_dual_pop(const Population_t<JUNCTION>& pop_1,
+                                 const Population_t<JUNCTION>& pop_2,
+                                 const marker_plan_t<JUNCTION>& plan,
+                                 int t,
+                                 arma::mat& output,
+                                 size_t first_row);
+
+// marker i lies on chromosome pair marker_chromosomes[i], or on the first
+// pair if marker_chromosomes is empty
+template <typename JUNCTION>
+arma::mat update_all_frequencies_tibble(const Population_t<JUNCTION>& pop,
                                         const NumericVector& markers,
+                                        const std::vector<int>& marker_chromosomes,
                                         const std::vector<int>& founder_labels,
                                         int t);
 
-arma::mat update_all_frequencies_tibble_dual_pop(const std::vector< Fish >& pop_1,
-                                                 const std::vector< Fish >& pop_2,
+template <typename JUNCTION>
+arma::mat update_all_frequencies_tibble_dual_pop(const Population_t<JUNCTION>& pop_1,
+                                                 const Population_t<JUNCTION>& pop_2,
                                                  const NumericVector& markers,
                                                  const std::vector<int>& founder_labels,
                                                  int t);
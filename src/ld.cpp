@@ -0,0 +1,322 @@
+//
+//  ld.cpp
+//
+//
+//  Linkage disequilibrium between markers. The ancestry of every haplotype at
+//  a marker is stored one-hot, as a bitset over haplotypes for every ancestry
+//  present at that marker, such that the number of haplotypes carrying
+//  ancestry i at one marker and j at another is the popcount of the
+//  intersection of two bitsets.
+//
+//  Statistics are either returned for all pairs of markers, or averaged over
+//  pairs in bins of the distance between the markers, for which memory does
+//  not grow with the number of markers.
+//
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "population_handle.h"
+#include "helper_functions.h"
+
+namespace {
+
+inline int popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// the number of haplotypes in both a and b
+int count_shared(const uint64_t* a, const uint64_t* b, size_t words) {
+    int count = 0;
+    for(size_t w = 0; w < words; ++w) count += popcount(a[w] & b[w]);
+    return count;
+}
+
+typedef int (*count_function)(const uint64_t*, const uint64_t*, size_t);
+
+// packages are not compiled for a specific processor, hence the popcount
+// instruction is only used if the processor running the code supports it
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+__attribute__((target("popcnt")))
+int count_shared_popcnt(const uint64_t* a, const uint64_t* b, size_t words) {
+    int count = 0;
+    for(size_t w = 0; w < words; ++w) count += __builtin_popcountll(a[w] & b[w]);
+    return count;
+}
+
+count_function select_count_function() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("popcnt")) return count_shared_popcnt;
+    return count_shared;
+}
+#else
+count_function select_count_function() {
+    return count_shared;
+}
+#endif
+
+struct ancestry_bitsets {
+    size_t num_haplotypes;
+    size_t words;  // per bitset
+    // per marker, the ancestries present, their bitsets (words each) and
+    // the number of haplotypes carrying them
+    std::vector< std::vector< int > > labels;
+    std::vector< std::vector< uint64_t > > bits;
+    std::vector< std::vector< int > > counts;
+    // whether every haplotype has an ancestry at the marker
+    std::vector< bool > complete;
+
+    const uint64_t* bitset(size_t marker, size_t allele) const {
+        return bits[marker].data() + allele * words;
+    }
+
+    // haplotypes 2 * i and 2 * i + 1 are the chromosomes of individual i
+    template <typename JUNCTION>
+    ancestry_bitsets(const Population_t<JUNCTION>& pop,
+                     const marker_plan_t<JUNCTION>& plan) :
+        num_haplotypes(2 * pop.size()),
+        words((num_haplotypes + 63) / 64),
+        labels(plan.locations.size()),
+        bits(plan.locations.size()),
+        counts(plan.locations.size()) {
+        size_t num_markers = plan.locations.size();
+        std::vector< int > genotype(2 * num_markers);
+        for(size_t i = 0; i < pop.size(); ++i) {
+            genotype_individual(pop, i, plan, genotype.data());
+            for(size_t m = 0; m < num_markers; ++m) {
+                for(size_t h = 0; h < 2; ++h) {
+                    int label = genotype[2 * m + h];
+                    // markers at or beyond the end of a chromosome
+                    if(label < 0) continue;
+                    size_t allele = std::find(labels[m].begin(), labels[m].end(),
+                                              label) - labels[m].begin();
+                    if(allele == labels[m].size()) {
+                        labels[m].push_back(label);
+                        bits[m].resize(bits[m].size() + words, 0);
+                        counts[m].push_back(0);
+                    }
+                    size_t haplotype = 2 * i + h;
+                    bits[m][allele * words + haplotype / 64] |=
+                        uint64_t(1) << (haplotype % 64);
+                    counts[m][allele]++;
+                }
+            }
+        }
+        for(size_t m = 0; m < num_markers; ++m) {
+            size_t carried = 0;
+            for(size_t a = 0; a < counts[m].size(); ++a) carried += counts[m][a];
+            complete.push_back(carried == num_haplotypes);
+        }
+    }
+};
+
+// average D' and r squared between markers x and y, over all pairs of
+// ancestries weighted by their frequencies. joint is used as buffer.
+void pairwise_ld(const ancestry_bitsets& haplotypes,
+                 count_function count,
+                 size_t x, size_t y,
+                 std::vector< int >& joint,
+                 double& ld, double& r_squared) {
+    const std::vector< int >& count_x = haplotypes.counts[x];
+    const std::vector< int >& count_y = haplotypes.counts[y];
+    size_t alleles_x = count_x.size();
+    size_t alleles_y = count_y.size();
+
+    // joint[i * alleles_y + j] haplotypes carry ancestry i at x and j at y.
+    // If all haplotypes have an ancestry at y, the counts of its last
+    // ancestry follow from the others, and likewise for x.
+    size_t counted_x = alleles_x - (haplotypes.complete[x] ? 1 : 0);
+    size_t counted_y = alleles_y - (haplotypes.complete[y] ? 1 : 0);
+    joint.assign(alleles_x * alleles_y, 0);
+    for(size_t i = 0; i < counted_x; ++i) {
+        for(size_t j = 0; j < counted_y; ++j) {
+            joint[i * alleles_y + j] = count(haplotypes.bitset(x, i),
+                                             haplotypes.bitset(y, j),
+                                             haplotypes.words);
+        }
+        if(counted_y < alleles_y) {
+            int rest = count_x[i];
+            for(size_t j = 0; j < counted_y; ++j) rest -= joint[i * alleles_y + j];
+            joint[i * alleles_y + counted_y] = rest;
+        }
+    }
+    if(counted_x < alleles_x) {
+        for(size_t j = 0; j < alleles_y; ++j) {
+            int rest = count_y[j];
+            for(size_t i = 0; i < counted_x; ++i) rest -= joint[i * alleles_y + j];
+            joint[counted_x * alleles_y + j] = rest;
+        }
+    }
+
+    ld = 0.0;
+    r_squared = 0.0;
+    double n = haplotypes.num_haplotypes;
+    for(size_t i = 0; i < alleles_x; ++i) {
+        double p_a = count_x[i] / n;
+        for(size_t j = 0; j < alleles_y; ++j) {
+            double p_b = count_y[j] / n;
+            double d = joint[i * alleles_y + j] / n - p_a * p_b;
+            double d_max = d < 0 ? std::min(p_a * p_b, (1 - p_a) * (1 - p_b))
+                                 : std::min(p_a * (1 - p_b), (1 - p_a) * p_b);
+            if(d_max > 0) {
+                ld += p_a * p_b * std::fabs(d / d_max);
+                r_squared += p_a * p_b * d * d /
+                             (p_a * (1 - p_a) * p_b * (1 - p_b));
+            }
+        }
+    }
+}
+
+template <typename JUNCTION>
+ancestry_bitsets genotype_handle(const population_handle& handle,
+                                 const Rcpp::NumericVector& markers) {
+    Population_t<JUNCTION> converted;
+    const Population_t<JUNCTION>* pop = handle.find<JUNCTION>();
+    if(!pop) {
+        converted = handle.get<JUNCTION>();
+        pop = &converted;
+    }
+    marker_plan_t<JUNCTION> plan(markers, std::vector<int>(), std::vector<int>(),
+                                 pop->num_chromosome_pairs);
+    return ancestry_bitsets(*pop, plan);
+}
+
+ancestry_bitsets genotype_handle(const Rcpp::RObject& population,
+                                 const Rcpp::NumericVector& markers) {
+    population_ptr handle = get_population_handle(population);
+    switch(handle->fixed_point_bits) {
+        case 32: return genotype_handle<junction_fixed32>(*handle, markers);
+        case 64: return genotype_handle<junction_fixed64>(*handle, markers);
+    }
+    return genotype_handle<junction>(*handle, markers);
+}
+
+// a uniform number in [0, 1) that only depends on seed and pair
+double pair_uniform(uint64_t seed, uint64_t pair) {
+    // splitmix64 finalizer
+    uint64_t z = seed * 0x9E3779B97F4A7C15ULL + pair + 1;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}
+
+// [[Rcpp::export]]
+Rcpp::List calculate_ld_cpp(Rcpp::RObject population,
+                            Rcpp::NumericVector markers,
+                            int num_threads) {
+    ancestry_bitsets haplotypes = genotype_handle(population, markers);
+
+    // the lower triangle, as in the matrices returned
+    int num_markers = markers.size();
+    std::vector< double > ld(num_markers * num_markers, NA_REAL);
+    std::vector< double > r_squared(num_markers * num_markers, NA_REAL);
+    count_function count = select_count_function();
+
+#pragma omp parallel for num_threads(std::max(1, num_threads)) schedule(dynamic, 1)
+    for(int x = 0; x < num_markers; ++x) {
+        std::vector< int > joint;
+        for(int y = 0; y < x; ++y) {
+            // column major
+            size_t index = y * num_markers + x;
+            pairwise_ld(haplotypes, count, x, y, joint,
+                        ld[index], r_squared[index]);
+        }
+    }
+
+    Rcpp::NumericMatrix ld_matrix(num_markers, num_markers);
+    Rcpp::NumericMatrix rsq_matrix(num_markers, num_markers);
+    std::copy(ld.begin(), ld.end(), ld_matrix.begin());
+    std::copy(r_squared.begin(), r_squared.end(), rsq_matrix.begin());
+    return Rcpp::List::create(Rcpp::Named("ld_matrix") = ld_matrix,
+                              Rcpp::Named("rsq_matrix") = rsq_matrix);
+}
+
+// mean ld and r squared of pairs of markers binned by their distance, for
+// pairs at most max_distance apart. Pairs are used with probability
+// pair_fraction. Only the sums per bin are kept, rather than the statistics
+// of all pairs.
+// [[Rcpp::export]]
+Rcpp::NumericMatrix calculate_ld_decay_cpp(Rcpp::RObject population,
+                                           Rcpp::NumericVector markers,
+                                           int number_of_bins,
+                                           double max_distance,
+                                           double pair_fraction,
+                                           int seed,
+                                           int num_threads) {
+    if(number_of_bins < 1) Rcpp::stop("number_of_bins has to be at least 1");
+    if(max_distance <= 0) Rcpp::stop("max_distance has to be positive");
+
+    ancestry_bitsets haplotypes = genotype_handle(population, markers);
+    count_function count = select_count_function();
+
+    // markers in order of location, such that the pairs within
+    // max_distance of a marker are contiguous
+    int num_markers = markers.size();
+    std::vector< int > order(num_markers);
+    for(int i = 0; i < num_markers; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return markers[a] < markers[b];
+    });
+    std::vector< double > location(num_markers);
+    for(int i = 0; i < num_markers; ++i) location[i] = markers[order[i]];
+
+    double bin_width = max_distance / number_of_bins;
+    // pairs, sum of ld and sum of r squared per bin, per chunk
+    int num_chunks = std::max(1, std::min(num_threads, num_markers));
+    std::vector< double > sums(num_chunks * number_of_bins * 3, 0.0);
+
+#pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+    for(int chunk = 0; chunk < num_chunks; ++chunk) {
+        double* local = sums.data() + chunk * number_of_bins * 3;
+        std::vector< int > joint;
+        // rows are interleaved across chunks, to balance the triangle
+        for(int x = chunk; x < num_markers; x += num_chunks) {
+            for(int y = x - 1; y >= 0; --y) {
+                double distance = location[x] - location[y];
+                if(distance > max_distance) break;
+                uint64_t pair = (uint64_t)order[x] * num_markers + order[y];
+                if(pair_fraction < 1.0 &&
+                   pair_uniform(seed, pair) >= pair_fraction) continue;
+
+                double ld, r_squared;
+                pairwise_ld(haplotypes, count, order[x], order[y], joint,
+                            ld, r_squared);
+                int bin = std::min(number_of_bins - 1,
+                                   (int)(distance / bin_width));
+                local[3 * bin] += 1.0;
+                local[3 * bin + 1] += ld;
+                local[3 * bin + 2] += r_squared;
+            }
+        }
+    }
+
+    // bin start, bin end, mean ld, mean r squared, number of pairs
+    Rcpp::NumericMatrix output(number_of_bins, 5);
+    for(int bin = 0; bin < number_of_bins; ++bin) {
+        double pairs = 0.0, ld = 0.0, r_squared = 0.0;
+        for(int chunk = 0; chunk < num_chunks; ++chunk) {
+            const double* local = sums.data() + (chunk * number_of_bins + bin) * 3;
+            pairs += local[0];
+            ld += local[1];
+            r_squared += local[2];
+        }
+        output(bin, 0) = bin * bin_width;
+        output(bin, 1) = (bin + 1) * bin_width;
+        output(bin, 2) = pairs > 0 ? ld / pairs : NA_REAL;
+        output(bin, 3) = pairs > 0 ? r_squared / pairs : NA_REAL;
+        output(bin, 4) = pairs;
+    }
+    return output;
+}
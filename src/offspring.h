@@ -0,0 +1,161 @@
+//
+//  offspring.h
+//
+//
+//  Generation of the offspring of a population, where the parents are
+//  drawn first and mating and fitness evaluation are spread over threads.
+//  Every offspring chromosome draws from its own stream of random numbers,
+//  such that the result does not depend on the number of threads.
+//
+
+#ifndef offspring_hpp
+#define offspring_hpp
+
+#include <vector>
+#include <algorithm>
+#include "Fish.h"
+#include "Population.h"
+#include "random_functions.h"
+#include "helper_functions.h"
+
+template <typename JUNCTION>
+struct mating_t {
+    const Population_t<JUNCTION>* parents_A;
+    size_t index_A;
+    const Population_t<JUNCTION>* parents_B;
+    size_t index_B;
+
+    mating_t(const Population_t<JUNCTION>& pop_A, size_t A,
+             const Population_t<JUNCTION>& pop_B, size_t B) :
+        parents_A(&pop_A), index_A(A), parents_B(&pop_B), index_B(B) {}
+};
+
+// closes the last chromosome of offspring, which was inherited from the
+// parental chromosomes first and first + 1 of parents. A chromosome that was
+// passed on without recombination (source 0 or 1) has not been copied yet, it
+// is added together with the hash of that parental chromosome and shared if
+// possible.
+template <typename JUNCTION>
+void close_offspring_chromosome(Population_t<JUNCTION>& offspring,
+                                const Population_t<JUNCTION>& parents,
+                                size_t first,
+                                int source) {
+    if(source >= 0) {
+        size_t k = first + source;
+        offspring.add_chromosome(parents.chromosome(k), parents.hashes[k]);
+    } else {
+        offspring.close_chromosome();
+    }
+}
+
+// sets the selected alleles of the last chromosome of offspring, a chromosome
+// of pair that was inherited from the parental chromosomes first and
+// first + 1 of parents. A chromosome that was passed on without recombination
+// (source 0 or 1) carries the alleles of that parental chromosome, only
+// recombinant chromosomes are scanned again.
+template <typename JUNCTION>
+void inherit_selected_alleles(Population_t<JUNCTION>& offspring,
+                              const Population_t<JUNCTION>& parents,
+                              size_t first,
+                              size_t pair,
+                              int source,
+                              const selection_plan_t<JUNCTION>& selection_plan) {
+    uint64_t* selected = offspring.add_selected();
+    if(source >= 0) {
+        const uint64_t* parental = parents.selected(first + source);
+        std::copy(parental, parental + offspring.selected_words, selected);
+    } else {
+        size_t k = offspring.num_chromosomes() - 1;
+        find_selected_alleles(offspring.chromosome(k), selection_plan, pair,
+                              selected);
+    }
+}
+
+// appends to offspring the chromosome of pair that individual of parents
+// passes on
+template <typename JUNCTION>
+void inherit_pair(Population_t<JUNCTION>& offspring,
+                  const Population_t<JUNCTION>& parents,
+                  size_t individual,
+                  size_t pair,
+                  double morgan,
+                  const selection_plan_t<JUNCTION>& selection_plan,
+                  bool use_selection) {
+    size_t first = parents.chromosome_index(individual, pair, 0);
+    int source = inherit_chromosome(offspring.junctions,
+                                    parents.chromosome(first),
+                                    parents.chromosome(first + 1),
+                                    morgan, false);
+    close_offspring_chromosome(offspring, parents, first, source);
+    if(use_selection) {
+        inherit_selected_alleles(offspring, parents, first, pair, source,
+                                 selection_plan);
+    }
+}
+
+// replaces offspring with the offspring of matings, which are individuals
+// first_individual, first_individual + 1, ... of generation. morgan holds the
+// length of every chromosome pair of the genome. buffers holds the
+// thread-local offspring and is reused across generations.
+template <typename JUNCTION>
+void generate_offspring(const std::vector< mating_t<JUNCTION> >& matings,
+                        int generation,
+                        int first_individual,
+                        const std::vector< double >& morgan,
+                        const selection_plan_t<JUNCTION>& selection_plan,
+                        bool use_selection,
+                        int num_threads,
+                        std::vector< Population_t<JUNCTION> >& buffers,
+                        Population_t<JUNCTION>& offspring,
+                        std::vector< double >& fitness) {
+
+    int num_offspring = matings.size();
+    int num_chunks = std::max(1, std::min(num_threads, num_offspring));
+    size_t num_pairs = morgan.size();
+    // with a single chunk, offspring is written to directly
+    if(num_chunks > 1) buffers.resize(num_chunks);
+
+    fitness.assign(num_offspring, -2.0);
+
+#pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+    for(int chunk = 0; chunk < num_chunks; ++chunk) {
+        int begin = (int)((long long)num_offspring * chunk / num_chunks);
+        int end   = (int)((long long)num_offspring * (chunk + 1) / num_chunks);
+
+        Population_t<JUNCTION>& local = num_chunks > 1 ? buffers[chunk] : offspring;
+        local.clear();
+        local.num_chromosome_pairs = num_pairs;
+        local.reserve((end - begin) * num_pairs);
+        local.selected_words = use_selection ? selection_plan.num_words() : 0;
+
+        for(int i = begin; i < end; ++i) {
+            const mating_t<JUNCTION>& focal = matings[i];
+
+            for(size_t c = 0; c < num_pairs; ++c) {
+                set_stream(generation, first_individual + i, 2 * c);
+                inherit_pair(local, *focal.parents_A, focal.index_A, c,
+                             morgan[c], selection_plan, use_selection);
+
+                set_stream(generation, first_individual + i, 2 * c + 1);
+                inherit_pair(local, *focal.parents_B, focal.index_B, c,
+                             morgan[c], selection_plan, use_selection);
+            }
+
+            if(use_selection) {
+                fitness[i] = calculate_fitness(local, i - begin, selection_plan);
+            }
+        }
+    }
+
+    if(num_chunks > 1) {
+        offspring.clear();
+        offspring.num_chromosome_pairs = num_pairs;
+        offspring.reserve(num_offspring * num_pairs);
+        offspring.selected_words = use_selection ? selection_plan.num_words() : 0;
+        for(int chunk = 0; chunk < num_chunks; ++chunk) {
+            offspring.append(buffers[chunk]);
+        }
+    }
+}
+
+#endif /* offspring_hpp */
@@ -0,0 +1,247 @@
+//
+//  population_file.cpp
+//
+//
+
+#include "population_file.h"
+#include <fstream>
+#include <cstring>
+#include <unordered_map>
+#include "helper_functions.h"
+#include "population_handle.h"
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char population_magic[4] = {'G', 'A', 'P', 'F'};
+const uint32_t population_version = 1;
+const uint32_t byte_order_mark = 0x01020304;
+
+struct population_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t unused;
+    uint64_t num_chromosome_pairs;
+    uint64_t num_chromosomes;
+    uint64_t num_junctions;
+};
+
+// read-only view on the contents of a file. The file is memory mapped where
+// possible, on Windows it is read into memory instead.
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& file_name) : data_(0), size_(0) {
+#ifdef _WIN32
+        std::ifstream in(file_name.c_str(), std::ios::binary);
+        if(!in) {
+            Rcpp::stop("could not open population file " + file_name);
+        }
+        contents.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>());
+        data_ = contents.data();
+        size_ = contents.size();
+#else
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if(fd < 0) {
+            Rcpp::stop("could not open population file " + file_name);
+        }
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close(fd);
+            Rcpp::stop("could not open population file " + file_name);
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if(size_ > 0) {
+            void* mapped = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapped == MAP_FAILED) {
+                close(fd);
+                Rcpp::stop("could not map population file " + file_name);
+            }
+            data_ = static_cast<const char*>(mapped);
+        }
+        close(fd);
+#endif
+    }
+
+    ~mapped_file() {
+#ifndef _WIN32
+        if(data_) munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    std::vector< char > contents;
+#endif
+
+    mapped_file(const mapped_file&);
+    mapped_file& operator=(const mapped_file&);
+};
+
+template <typename T>
+void write_array(std::ofstream& out, const std::vector< T >& v) {
+    if(v.empty()) return;
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+}
+
+template <typename JUNCTION>
+void write_population_file(const Population_t<JUNCTION>& pop,
+                           const std::string& file_name) {
+    // chromosomes that share their junctions in pop, share them in the file
+    std::unordered_map< size_t, uint64_t > stored;
+    std::vector< uint64_t > begin(pop.num_chromosomes());
+    std::vector< uint64_t > end(pop.num_chromosomes());
+    std::vector< double > position;
+    std::vector< int32_t > ancestry;
+    position.reserve(pop.junctions.size());
+    ancestry.reserve(pop.junctions.size());
+
+    for(size_t k = 0; k < pop.num_chromosomes(); ++k) {
+        const chromosome_span& span = pop.spans[k];
+        auto found = stored.find(span.begin);
+        if(found == stored.end() ||
+           end[found->second] - begin[found->second] != span.end - span.begin) {
+            begin[k] = position.size();
+            for(size_t j = span.begin; j < span.end; ++j) {
+                position.push_back(JUNCTION::decode(pop.junctions[j].pos));
+                ancestry.push_back(pop.junctions[j].right);
+            }
+            end[k] = position.size();
+            stored[span.begin] = k;
+        } else {
+            begin[k] = begin[found->second];
+            end[k] = end[found->second];
+        }
+    }
+
+    population_header header;
+    std::memcpy(header.magic, population_magic, 4);
+    header.version = population_version;
+    header.byte_order = byte_order_mark;
+    header.unused = 0;
+    header.num_chromosome_pairs = pop.num_chromosome_pairs;
+    header.num_chromosomes = pop.num_chromosomes();
+    header.num_junctions = position.size();
+
+    std::ofstream out(file_name.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out) {
+        Rcpp::stop("could not open population file " + file_name);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, begin);
+    write_array(out, end);
+    write_array(out, position);
+    write_array(out, ancestry);
+    if(!out) {
+        Rcpp::stop("could not write to population file " + file_name);
+    }
+}
+
+template <typename JUNCTION>
+Population_t<JUNCTION> read_population_file(const std::string& file_name) {
+    mapped_file file(file_name);
+
+    population_header header;
+    if(file.size() < sizeof(header) ||
+       std::memcmp(file.data(), population_magic, 4) != 0) {
+        Rcpp::stop(file_name + " is not a population file");
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(header.byte_order != byte_order_mark) {
+        Rcpp::stop(file_name + " was written on a machine with a different byte order");
+    }
+    if(header.version != population_version) {
+        Rcpp::stop(file_name + " was written by an unknown version");
+    }
+
+    // the counts are bounded by the size of the file before the expected
+    // size is calculated, such that a damaged header can not overflow it
+    const uint64_t C = header.num_chromosomes;
+    const uint64_t J = header.num_junctions;
+    const uint64_t P = header.num_chromosome_pairs;
+    const uint64_t body = file.size() - sizeof(header);
+    if(P == 0 || C % P != 0 || (C / P) % 2 != 0 ||
+       C > body / (2 * sizeof(uint64_t)) ||
+       J > body / (sizeof(double) + sizeof(int32_t)) ||
+       body != 2 * C * sizeof(uint64_t) +
+               J * (sizeof(double) + sizeof(int32_t))) {
+        Rcpp::stop(file_name + " is damaged");
+    }
+
+    // the header and offsets are a multiple of 8 bytes, such that the
+    // arrays in the mapped file are properly aligned
+    const char* data = file.data() + sizeof(header);
+    const uint64_t* begin = reinterpret_cast<const uint64_t*>(data);
+    const uint64_t* end = begin + C;
+    const double* position = reinterpret_cast<const double*>(end + C);
+    const int32_t* ancestry = reinterpret_cast<const int32_t*>(position + J);
+
+    Population_t<JUNCTION> pop;
+    pop.num_chromosome_pairs = P;
+    pop.reserve(C / 2);
+    pop.junctions.reserve(J);
+
+    // chromosomes are encoded straight into the population, chromosomes that
+    // share their junctions in the file are encoded and hashed only once
+    std::unordered_map< uint64_t, size_t > shared;
+    for(size_t k = 0; k < C; ++k) {
+        if(begin[k] > end[k] || end[k] > J) {
+            Rcpp::stop(file_name + " is damaged");
+        }
+        auto found = shared.find(begin[k]);
+        if(found != shared.end() && end[found->second] == end[k]) {
+            pop.add_shared(found->second);
+            continue;
+        }
+        for(uint64_t j = begin[k]; j < end[k]; ++j) {
+            pop.junctions.push_back(JUNCTION(JUNCTION::encode(position[j]),
+                                             ancestry[j]));
+        }
+        pop.close_chromosome();
+        shared[begin[k]] = k;
+    }
+    return pop;
+}
+
+// [[Rcpp::export]]
+void save_population_cpp(Rcpp::RObject handle,
+                         std::string file_name) {
+    population_ptr ptr = get_population_handle(handle);
+    switch(ptr->fixed_point_bits) {
+        case 32: write_population_file(ptr->population_32, file_name); break;
+        case 64: write_population_file(ptr->population_64, file_name); break;
+        default: write_population_file(ptr->population_0, file_name); break;
+    }
+}
+
+// [[Rcpp::export]]
+Rcpp::RObject load_population_cpp(std::string file_name,
+                                  bool as_handle) {
+    Population_t<junction> pop = read_population_file<junction>(file_name);
+    return population_output(pop, as_handle);
+}
+
+#define INSTANTIATE_POPULATION_FILE(JUNCTION)                                  \
+template void write_population_file(const Population_t<JUNCTION>&,             \
+                                    const std::string&);                       \
+template Population_t<JUNCTION> read_population_file(const std::string&);
+
+INSTANTIATE_POPULATION_FILE(junction)
+INSTANTIATE_POPULATION_FILE(junction_fixed32)
+INSTANTIATE_POPULATION_FILE(junction_fixed64)
@@ -0,0 +1,33 @@
+//
+//  population_file.h
+//
+//
+//  Binary population files, which are memory mapped when read such that a
+//  population is built from the file without parsing it junction by
+//  junction. Identical chromosomes share their junctions in the file as they
+//  do in memory.
+//
+//    header     "GAPF", uint32 version, uint32 byte order mark 0x01020304,
+//               uint32 unused, uint64 chromosome pairs per individual,
+//               uint64 chromosomes C, uint64 junctions J
+//    offsets    uint64 begin[C], uint64 end[C], junctions of chromosome k
+//               are [begin[k], end[k])
+//    junctions  double position[J], int32 ancestry[J]
+//
+//  Values are stored in the byte order of the machine that wrote the file.
+//
+
+#ifndef population_file_hpp
+#define population_file_hpp
+
+#include <string>
+#include "Population.h"
+
+template <typename JUNCTION>
+void write_population_file(const Population_t<JUNCTION>& pop,
+                           const std::string& file_name);
+
+template <typename JUNCTION>
+Population_t<JUNCTION> read_population_file(const std::string& file_name);
+
+#endif /* population_file_hpp */
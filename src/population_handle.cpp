@@ -0,0 +1,219 @@
+//
+//  population_handle.cpp
+//
+//
+
+#include "population_handle.h"
+#include "helper_functions.h"
+
+namespace {
+
+Population_t<junction>& storage(population_handle& h, junction*) {
+    return h.population_0;
+}
+Population_t<junction_fixed32>& storage(population_handle& h, junction_fixed32*) {
+    return h.population_32;
+}
+Population_t<junction_fixed64>& storage(population_handle& h, junction_fixed64*) {
+    return h.population_64;
+}
+
+int bits_of(junction*) { return 0; }
+int bits_of(junction_fixed32*) { return 32; }
+int bits_of(junction_fixed64*) { return 64; }
+
+template <typename TO, typename FROM>
+void convert_population(const Population_t<FROM>& from, Population_t<TO>& to) {
+    to.clear();
+    to.num_chromosome_pairs = from.num_chromosome_pairs;
+    to.reserve(from.size());
+    std::vector< TO > chrom;
+    for(size_t k = 0; k < from.num_chromosomes(); ++k) {
+        chrom.clear();
+        chromosome_view<FROM> source = from.chromosome(k);
+        for(const FROM* it = source.begin(); it != source.end(); ++it) {
+            chrom.push_back(TO(TO::encode(FROM::decode(it->pos)), it->right));
+        }
+        to.add_chromosome(chromosome_view<TO>(chrom));
+    }
+}
+
+template <typename JUNCTION>
+void convert_population(const Population_t<JUNCTION>& from,
+                        Population_t<JUNCTION>& to) {
+    to = from;
+}
+
+// the individuals of pop, or all individuals if there are none
+template <typename JUNCTION>
+List convert_individuals(const Population_t<JUNCTION>& pop,
+                         const IntegerVector& individuals) {
+    if(individuals.size() == 0) return convert_to_list(pop);
+
+    Population_t<JUNCTION> subset;
+    subset.num_chromosome_pairs = pop.num_chromosome_pairs;
+    for(int i = 0; i < individuals.size(); ++i) {
+        if(individuals[i] < 0 || individuals[i] >= (int)pop.size()) {
+            Rcpp::stop("individual not in population");
+        }
+        subset.add_individual(pop, individuals[i]);
+    }
+    return convert_to_list(subset);
+}
+
+// a matrix, or with several chromosomes a list with a matrix for every
+// chromosome
+template <typename JUNCTION>
+Rcpp::RObject convert_matrices(const Population_t<JUNCTION>& pop) {
+    if(pop.num_chromosome_pairs == 1) {
+        return Rcpp::wrap(convert_to_matrix(pop, 0));
+    }
+    List output(pop.num_chromosome_pairs);
+    for(size_t c = 0; c < pop.num_chromosome_pairs; ++c) {
+        output(c) = convert_to_matrix(pop, c);
+    }
+    return Rcpp::wrap(output);
+}
+
+}
+
+template <typename JUNCTION>
+void population_handle::set(Population_t<JUNCTION>& pop) {
+    population_0.clear();
+    population_32.clear();
+    population_64.clear();
+    storage(*this, static_cast<JUNCTION*>(0)).swap(pop);
+    fixed_point_bits = bits_of(static_cast<JUNCTION*>(0));
+}
+
+template <typename JUNCTION>
+Population_t<JUNCTION> population_handle::get() const {
+    Population_t<JUNCTION> output;
+    switch(fixed_point_bits) {
+        case 0:  convert_population(population_0, output); break;
+        case 32: convert_population(population_32, output); break;
+        case 64: convert_population(population_64, output); break;
+    }
+    return output;
+}
+
+template <typename JUNCTION>
+const Population_t<JUNCTION>* population_handle::find() const {
+    if(fixed_point_bits != bits_of(static_cast<JUNCTION*>(0))) return 0;
+    return &storage(const_cast<population_handle&>(*this),
+                    static_cast<JUNCTION*>(0));
+}
+
+size_t population_handle::size() const {
+    switch(fixed_point_bits) {
+        case 32: return population_32.size();
+        case 64: return population_64.size();
+    }
+    return population_0.size();
+}
+
+size_t population_handle::num_chromosome_pairs() const {
+    switch(fixed_point_bits) {
+        case 32: return population_32.num_chromosome_pairs;
+        case 64: return population_64.num_chromosome_pairs;
+    }
+    return population_0.num_chromosome_pairs;
+}
+
+template <typename JUNCTION>
+Rcpp::RObject make_population_handle(Population_t<JUNCTION>& pop) {
+    population_ptr ptr(new population_handle(), true);
+    ptr->set(pop);
+    ptr.attr("class") = "population_handle";
+    return Rcpp::wrap(ptr);
+}
+
+template <typename JUNCTION>
+Rcpp::RObject population_output(Population_t<JUNCTION>& pop, bool as_handle) {
+    if(as_handle) return make_population_handle(pop);
+    return Rcpp::wrap(convert_to_list(pop));
+}
+
+bool is_population_handle(const Rcpp::RObject& x) {
+    return TYPEOF(x) == EXTPTRSXP;
+}
+
+population_ptr get_population_handle(const Rcpp::RObject& x) {
+    if(!is_population_handle(x)) {
+        Rcpp::stop("not a population handle");
+    }
+    population_ptr ptr(x);
+    if(!ptr.get()) {
+        Rcpp::stop("population handle is no longer valid, handles do not persist across R sessions");
+    }
+    return ptr;
+}
+
+template <typename JUNCTION>
+bool get_input_population(const Rcpp::RObject& input,
+                          Population_t<JUNCTION>& pop) {
+    if(is_population_handle(input)) {
+        pop = get_population_handle(input)->get<JUNCTION>();
+        return true;
+    }
+    NumericVector v = Rcpp::as<NumericVector>(input);
+    if(v[0] <= -1e4) return false;
+    pop = Population_t<JUNCTION>(convert_NumericVector_to_fishVector<JUNCTION>(v));
+    return true;
+}
+
+// [[Rcpp::export]]
+Rcpp::RObject create_population_handle_cpp(Rcpp::List populations) {
+    Population_t<junction> pop = convert_from_list<junction>(populations);
+    return make_population_handle(pop);
+}
+
+// [[Rcpp::export]]
+Rcpp::RObject create_population_handle_from_matrix_cpp(Rcpp::List matrices) {
+    Population_t<junction> pop = convert_from_matrix<junction>(matrices);
+    return make_population_handle(pop);
+}
+
+// [[Rcpp::export]]
+List population_handle_to_list_cpp(Rcpp::RObject handle,
+                                   Rcpp::IntegerVector individuals) {
+    population_ptr ptr = get_population_handle(handle);
+    switch(ptr->fixed_point_bits) {
+        case 32: return convert_individuals(ptr->population_32, individuals);
+        case 64: return convert_individuals(ptr->population_64, individuals);
+    }
+    return convert_individuals(ptr->population_0, individuals);
+}
+
+// [[Rcpp::export]]
+Rcpp::RObject population_handle_to_matrix_cpp(Rcpp::RObject handle) {
+    population_ptr ptr = get_population_handle(handle);
+    switch(ptr->fixed_point_bits) {
+        case 32: return convert_matrices(ptr->population_32);
+        case 64: return convert_matrices(ptr->population_64);
+    }
+    return convert_matrices(ptr->population_0);
+}
+
+// [[Rcpp::export]]
+NumericVector population_handle_info_cpp(Rcpp::RObject handle) {
+    population_ptr ptr = get_population_handle(handle);
+    NumericVector info(3);
+    info[0] = ptr->size();
+    info[1] = ptr->num_chromosome_pairs();
+    info[2] = ptr->fixed_point_bits;
+    return info;
+}
+
+#define INSTANTIATE_POPULATION_HANDLE(JUNCTION)                                \
+template void population_handle::set(Population_t<JUNCTION>&);                 \
+template Population_t<JUNCTION> population_handle::get() const;                \
+template const Population_t<JUNCTION>* population_handle::find() const;        \
+template Rcpp::RObject make_population_handle(Population_t<JUNCTION>&);        \
+template Rcpp::RObject population_output(Population_t<JUNCTION>&, bool);       \
+template bool get_input_population(const Rcpp::RObject&,                       \
+                                   Population_t<JUNCTION>&);
+
+INSTANTIATE_POPULATION_HANDLE(junction)
+INSTANTIATE_POPULATION_HANDLE(junction_fixed32)
+INSTANTIATE_POPULATION_HANDLE(junction_fixed64)
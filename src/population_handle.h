@@ -0,0 +1,66 @@
+//
+//  population_handle.h
+//
+//
+//  A population that stays on the C++ side between calls, exposed to R as an
+//  external pointer of class "population_handle". It is only converted to a
+//  list of individuals when asked for, such that the output of one
+//  simulation can be the input of the next without the round trip through R
+//  lists. The population is kept in the junction type it was simulated with,
+//  and converted when it is used with another type.
+//
+
+#ifndef population_handle_hpp
+#define population_handle_hpp
+
+#include "Population.h"
+#include <RcppArmadillo.h>
+
+struct population_handle {
+    // 0, 32 or 64, as fixed_point_bits, selects the population in use
+    int fixed_point_bits;
+    Population_t<junction> population_0;
+    Population_t<junction_fixed32> population_32;
+    Population_t<junction_fixed64> population_64;
+
+    population_handle() : fixed_point_bits(0) {}
+
+    // takes over the junctions of pop
+    template <typename JUNCTION>
+    void set(Population_t<JUNCTION>& pop);
+
+    // a copy of the population, in junction type JUNCTION
+    template <typename JUNCTION>
+    Population_t<JUNCTION> get() const;
+
+    // the population if it is kept in junction type JUNCTION, else 0
+    template <typename JUNCTION>
+    const Population_t<JUNCTION>* find() const;
+
+    size_t size() const;
+    size_t num_chromosome_pairs() const;
+};
+
+typedef Rcpp::XPtr< population_handle > population_ptr;
+
+// wraps pop, of which the junctions are taken over, in a handle
+template <typename JUNCTION>
+Rcpp::RObject make_population_handle(Population_t<JUNCTION>& pop);
+
+// pop as returned to R, either as a handle or as a list of individuals
+template <typename JUNCTION>
+Rcpp::RObject population_output(Population_t<JUNCTION>& pop, bool as_handle);
+
+// the handle in x, stops if x is not a valid handle
+population_ptr get_population_handle(const Rcpp::RObject& x);
+
+bool is_population_handle(const Rcpp::RObject& x);
+
+// the input population of a simulation, passed from R either as a handle or
+// as a flattened population, where c(-1e6, -1e6) indicates that there is
+// none. Returns false if there is no input population.
+template <typename JUNCTION>
+bool get_input_population(const Rcpp::RObject& input,
+                          Population_t<JUNCTION>& pop);
+
+#endif /* population_handle_hpp */
@@ -11,11 +11,11 @@
 #include <random>
 using namespace Rcpp;
 
-std::random_device rd;
-std::mt19937 rndgen(rd());  //< The one and only random number generator
-std::uniform_real_distribution<> unif_dist = std::uniform_real_distribution<>(0, 1.0);
-std::poisson_distribution<int> poisson_preset_dist;
-std::uniform_int_distribution<> rand_num_dist;
+unsigned current_seed = 0;
+thread_local philox4x32 rndgen;  //< The one and only random number generator
+thread_local std::uniform_real_distribution<> unif_dist = std::uniform_real_distribution<>(0, 1.0);
+thread_local std::poisson_distribution<int> poisson_dist;
+thread_local std::exponential_distribution<> exp_dist = std::exponential_distribution<>(1.0);
 
 int random_number(int n)    {
     return std::uniform_int_distribution<> (0, n-1)(rndgen);
@@ -25,15 +25,26 @@ double uniform()    {
     return  unif_dist(rndgen);  //std::uniform_real_distribution<>(0, 1.0)(rndgen);
 }
 
-int poisson_preset() {
-    return poisson_preset_dist(rndgen);
+double exponential() {
+    return exp_dist(rndgen);
 }
 
-void set_poisson(double lambda) {
-    poisson_preset_dist = std::poisson_distribution<int>(lambda);
+int poisson(double lambda) {
+    if(poisson_dist.mean() != lambda) {
+        poisson_dist = std::poisson_distribution<int>(lambda);
+    }
+    return poisson_dist(rndgen);
 }
 
 void set_seed(unsigned seed)    {
-    std::mt19937 new_randomizer(seed);
-    rndgen = new_randomizer;
-}
\ No newline at end of file
+    current_seed = seed;
+    set_stream(initial_generation, parent_stream, 0);
+}
+
+void set_stream(uint32_t generation, uint32_t individual, uint32_t chromosome) {
+    rndgen.set_stream(current_seed, generation, individual, chromosome);
+    // distributions carry no state across streams
+    unif_dist.reset();
+    exp_dist.reset();
+    poisson_dist.reset();
+}
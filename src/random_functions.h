@@ -11,11 +11,93 @@
 
 #include <random>
 #include <vector>
+#include <cstdint>
+
+// Counter-based random number generator (Philox4x32-10, Salmon et al. 2011,
+// "Parallel random numbers: as easy as 1, 2, 3"). The output is a fixed
+// function of key and counter, hence streams can be derived for any key
+// without seeding cost, and skipping ahead is free.
+class philox4x32 {
+public:
+    typedef uint32_t result_type;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFF; }
+
+    philox4x32() : position(0) {
+        set_stream(0, 0, 0, 0);
+    }
+
+    // key (k0, k1) and stream (c0, c1), restarts at the first draw
+    void set_stream(uint32_t k0, uint32_t k1, uint32_t c0, uint32_t c1) {
+        key[0] = k0;
+        key[1] = k1;
+        stream[0] = c0;
+        stream[1] = c1;
+        position = 0;
+    }
+
+    result_type operator()() {
+        if(position % 4 == 0) generate_block(position / 4);
+        return block[position++ % 4];
+    }
+
+    void discard(unsigned long long n) {
+        position += n;
+        if(position % 4 != 0) generate_block(position / 4);
+    }
+
+private:
+    uint32_t key[2];
+    uint32_t stream[2];
+    uint32_t block[4];
+    uint64_t position; // number of draws made from this stream
+
+    static void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+        uint64_t product = static_cast<uint64_t>(a) * b;
+        hi = static_cast<uint32_t>(product >> 32);
+        lo = static_cast<uint32_t>(product);
+    }
+
+    void generate_block(uint64_t counter) {
+        uint32_t x[4] = {static_cast<uint32_t>(counter),
+                         static_cast<uint32_t>(counter >> 32),
+                         stream[0], stream[1]};
+        uint32_t k[2] = {key[0], key[1]};
+        for(int round = 0; round < 10; ++round) {
+            uint32_t hi0, lo0, hi1, lo1;
+            mulhilo(0xD2511F53, x[0], hi0, lo0);
+            mulhilo(0xCD9E8D57, x[2], hi1, lo1);
+            x[0] = hi1 ^ x[1] ^ k[0];
+            x[1] = lo1;
+            x[2] = hi0 ^ x[3] ^ k[1];
+            x[3] = lo0;
+            k[0] += 0x9E3779B9;
+            k[1] += 0xBB67AE85;
+        }
+        for(int i = 0; i < 4; ++i) block[i] = x[i];
+    }
+};
+
+// Each thread draws from its own stream, streams are identified by the seed,
+// the generation, the individual within that generation, and the chromosome
+// of that individual.
+
+// individual of the streams used to draw parents, and chromosome of these
+// streams is the population
+const uint32_t parent_stream = 0xFFFFFFFF;
+// generation of the streams used to create the initial population
+const uint32_t initial_generation = 0xFFFFFFFF;
 
 double uniform();
+// exponentially distributed, with rate 1
+double exponential();
 int random_number(int n);
+// sets the seed, and continues on the stream of the initial population
 void set_seed(unsigned seed);
+void set_stream(uint32_t generation, uint32_t individual, uint32_t chromosome);
 
-int poisson_preset();
-void set_poisson(double lambda);
+// Poisson distributed with mean lambda. The distribution is only rebuilt
+// when lambda differs from the previous draw.
+int poisson(double lambda);
 #endif /* random_functions_hpp */
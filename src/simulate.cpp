@@ -11,6 +11,8 @@
 #include <cstdlib>
 #include <numeric>
 #include <cmath>
+#include <memory>
+#include <string>
 
 #include <vector>
 #include <algorithm>
@@ -18,44 +20,67 @@
 #include "Fish.h"
 #include "random_functions.h"
 #include "helper_functions.h"
+#include "Population.h"
+#include "offspring.h"
+#include "tree_sequence.h"
+#include "frequency_file.h"
+#include "population_file.h"
+#include "population_handle.h"
 
 #include <RcppArmadillo.h>
 // [[Rcpp::depends("RcppArmadillo")]]
 using namespace Rcpp;
 
-std::vector< Fish > simulate_Population(const std::vector< Fish>& sourcePop,
-                                        const NumericMatrix& select,
-                                        int pop_size,
-                                        int total_runtime,
-                                        double morgan,
-                                        bool progress_bar,
-                                        arma::mat& frequencies,
-                                        bool track_frequency,
-                                        const NumericVector& track_markers,
-                                        bool track_junctions,
-                                        std::vector<double>& junctions,
-                                        bool multiplicative_selection,
-                                        int num_alleles,
-                                        const std::vector<int>& founder_labels) {
+template <typename JUNCTION>
+Population_t<JUNCTION> simulate_Population(const Population_t<JUNCTION>& sourcePop,
+                                           const NumericMatrix& select,
+                                           int pop_size,
+                                           int total_runtime,
+                                           const std::vector<double>& morgan,
+                                           bool progress_bar,
+                                           arma::mat& frequencies,
+                                           frequency_writer* frequency_file,
+                                           bool track_frequency,
+                                           const NumericVector& track_markers,
+                                           const std::vector<int>& marker_chromosomes,
+                                           const std::vector<int>& track_generations,
+                                           bool track_junctions,
+                                           std::vector<double>& junctions,
+                                           bool track_haplotypes,
+                                           std::vector<int>& haplotypes,
+                                           bool multiplicative_selection,
+                                           int num_alleles,
+                                           const std::vector<int>& founder_labels,
+                                           int num_threads) {
 
   //Rcout << "simulate_population: " << multiplicative_selection << "\n";
 
   bool use_selection = false;
   if(select(1, 1) >= 0) use_selection = true;
 
-  std::vector<Fish> Pop = sourcePop;
+  // the current and the next generation, the memory of both is reused
+  // across generations
+  Population_t<JUNCTION> Pop = sourcePop;
+  Population_t<JUNCTION> newGeneration;
+  std::vector< Population_t<JUNCTION> > thread_buffers;
+  std::vector< mating_t<JUNCTION> > matings;
   std::vector<double> fitness;
-  double maxFitness = -1;
+  alias_table fitness_sampler;
+  selection_plan_t<JUNCTION> selection_plan(select, multiplicative_selection,
+                                            morgan.size());
 
   if(use_selection) {
-    for(auto it = Pop.begin(); it != Pop.end(); ++it){
-      double fit = calculate_fitness((*it), select, multiplicative_selection);
-      if(fit > maxFitness) maxFitness = fit;
-
+    find_selected_alleles(Pop, selection_plan);
+    for(size_t i = 0; i < Pop.size(); ++i){
+      double fit = calculate_fitness(Pop, i, selection_plan);
       fitness.push_back(fit);
     }
   }
 
+  marker_plan_t<JUNCTION> marker_plan(track_markers, marker_chromosomes,
+                                      founder_labels, morgan.size());
+  size_t next_record = 0;
+
   int updateFreq = total_runtime / 20;
   if(updateFreq < 1) updateFreq = 1;
 
@@ -67,54 +92,44 @@ std::vector< Fish > simulate_Population(const std::vector< Fish>& sourcePop,
   for(int t = 0; t < total_runtime; ++t) {
 
     if(track_junctions) junctions.push_back(calc_mean_junctions(Pop));
+    if(track_haplotypes) haplotypes.push_back(count_haplotypes(Pop));
 
-    if(track_frequency) {
-      for(int i = 0; i < track_markers.size(); ++i) {
-        if(track_markers[i] < 0) break;
-        arma::mat local_mat = update_frequency_tibble(Pop,
-                                                      track_markers[i],
-                                                                   founder_labels,
-                                                                   t);
-
-        // now we have to find where to copy local_mat into frequencies
-        int time_block = track_markers.size() * founder_labels.size(); // number of markers times number of alleles
-
-        int start_add_time = t * time_block;
-        int start_add_marker = i * founder_labels.size() + start_add_time;
-
-        for(int j = 0; j < founder_labels.size(); ++j) {
-          for(int k = 0; k < 4; ++k) {
-            frequencies(start_add_marker + j, k)  = local_mat(j, k);
-          }
-        }
+    // frequencies are recorded in the generations in track_generations
+    if(track_frequency && next_record < track_generations.size() &&
+       track_generations[next_record] == t) {
+      if(frequency_file) {
+        write_frequencies(*frequency_file, marker_plan, t, Pop);
+      } else {
+        record_frequencies(Pop, marker_plan, t, frequencies,
+                           next_record * marker_plan.num_rows());
       }
+      next_record++;
     }
 
-    std::vector<Fish> newGeneration(pop_size);
     std::vector<double> newFitness;
-    double newMaxFitness = -1.0;
+    matings.clear();
+    set_stream(t, parent_stream, 0);
+    if (use_selection) fitness_sampler.build(fitness, multiplicative_selection);
     for (int i = 0; i < pop_size; ++i)  {
       int index1 = 0;
       int index2 = 0;
       if (use_selection) {
-        index1 = draw_prop_fitness(fitness, maxFitness);
-        index2 = draw_prop_fitness(fitness, maxFitness);
-        while(index2 == index1) index2 = draw_prop_fitness(fitness, maxFitness);
+        index1 = fitness_sampler.draw();
+        index2 = fitness_sampler.draw();
+        while(index2 == index1) index2 = fitness_sampler.draw();
       } else {
         index1 = random_number( (int)Pop.size() );
         index2 = random_number( (int)Pop.size() );
         while(index2 == index1) index2 = random_number( (int)Pop.size() );
       }
 
-      newGeneration[i] = mate(Pop[index1], Pop[index2], morgan);
-
-      double fit = -2.0;
-      if(use_selection) fit = calculate_fitness(newGeneration[i], select, multiplicative_selection);
-      if(fit > newMaxFitness) newMaxFitness = fit;
-
-      newFitness.push_back(fit);
+      matings.push_back(mating_t<JUNCTION>(Pop, index1, Pop, index2));
     }
 
+    generate_offspring(matings, t, 0, morgan, selection_plan, use_selection,
+                       num_threads, thread_buffers,
+                       newGeneration, newFitness);
+
     if (t % updateFreq == 0 && progress_bar) {
       Rcout << "**";
     }
@@ -129,62 +144,211 @@ std::vector< Fish > simulate_Population(const std::vector< Fish>& sourcePop,
 
     Pop.swap(newGeneration);
     fitness.swap(newFitness);
-    maxFitness = newMaxFitness;
   }
   if(progress_bar) Rcout << "\n";
   return(Pop);
 }
 
-// [[Rcpp::export]]
-List simulate_cpp(Rcpp::NumericVector input_population,
-                  NumericMatrix select,
-                  int pop_size,
-                  int number_of_founders,
-                  Rcpp::NumericVector starting_proportions,
-                  int total_runtime,
-                  double morgan,
-                  bool progress_bar,
-                  bool track_frequency,
-                  NumericVector track_markers,
-                  bool track_junctions,
-                  bool multiplicative_selection,
-                  int seed) {
+// Neutral simulation that records the genealogy of the population instead of
+// the junctions of every generation. The parents and breakpoints are drawn
+// from the same random numbers as in simulate_Population.
+template <typename JUNCTION>
+void simulate_genealogy(tree_sequence_t<JUNCTION>& genealogy,
+                        int pop_size,
+                        int total_runtime,
+                        const std::vector<double>& morgan,
+                        bool progress_bar,
+                        int num_threads) {
+
+  typedef typename tree_sequence_t<JUNCTION>::edge_t edge_t;
+
+  std::vector< std::vector< edge_t > > thread_edges;
+  std::vector< int > parents;
+  std::vector< int > index1(pop_size), index2(pop_size);
+  size_t num_pairs = morgan.size();
+  // the genealogy is simplified whenever its size has doubled
+  size_t simplified_size = 2 * pop_size * num_pairs;
+
+  int updateFreq = total_runtime / 20;
+  if(updateFreq < 1) updateFreq = 1;
+
+  if(progress_bar) {
+    Rcout << "0--------25--------50--------75--------100\n";
+    Rcout << "*";
+  }
+
+  for(int t = 0; t < total_runtime; ++t) {
+    int num_parents = genealogy.samples.size() / (2 * num_pairs);
+
+    set_stream(t, parent_stream, 0);
+    for (int i = 0; i < pop_size; ++i)  {
+      index1[i] = random_number(num_parents);
+      index2[i] = random_number(num_parents);
+      while(index2[i] == index1[i]) index2[i] = random_number(num_parents);
+    }
+
+    parents.swap(genealogy.samples);
+    int first_node = genealogy.add_generation(t + 1, 2 * pop_size * num_pairs);
+
+    int num_chunks = std::max(1, std::min(num_threads, pop_size));
+    thread_edges.resize(num_chunks);
+
+#pragma omp parallel for num_threads(num_chunks) schedule(static, 1)
+    for(int chunk = 0; chunk < num_chunks; ++chunk) {
+      int begin = (int)((long long)pop_size * chunk / num_chunks);
+      int end   = (int)((long long)pop_size * (chunk + 1) / num_chunks);
+
+      std::vector< edge_t >& local = thread_edges[chunk];
+      local.clear();
+      for(int i = begin; i < end; ++i) {
+        for(size_t c = 0; c < num_pairs; ++c) {
+          // chromosome h of pair c of individual j is node 2 (j K + c) + h
+          int child = first_node + 2 * (i * num_pairs + c);
+          int parent1 = 2 * (index1[i] * num_pairs + c);
+          int parent2 = 2 * (index2[i] * num_pairs + c);
+
+          set_stream(t, i, 2 * c);
+          record_meiosis<JUNCTION>(local, child,
+                                   parents[parent1], parents[parent1 + 1],
+                                   morgan[c]);
+          set_stream(t, i, 2 * c + 1);
+          record_meiosis<JUNCTION>(local, child + 1,
+                                   parents[parent2], parents[parent2 + 1],
+                                   morgan[c]);
+        }
+      }
+    }
+
+    for(int chunk = 0; chunk < num_chunks; ++chunk) {
+      genealogy.edges.insert(genealogy.edges.end(),
+                             thread_edges[chunk].begin(),
+                             thread_edges[chunk].end());
+    }
+
+    if(genealogy.edges.size() > 2 * simplified_size) {
+      genealogy.simplify();
+      simplified_size = std::max(genealogy.edges.size(),
+                                 (size_t)(2 * pop_size * num_pairs));
+    }
+
+    if (t % updateFreq == 0 && progress_bar) {
+      Rcout << "**";
+    }
+
+    Rcpp::checkUserInterrupt();
+  }
+  genealogy.simplify();
+  if(progress_bar) Rcout << "\n";
+}
+
+template <typename JUNCTION>
+List genealogy_to_list(const tree_sequence_t<JUNCTION>& genealogy) {
+  NumericMatrix edges(genealogy.edges.size(), 4);
+  for(size_t i = 0; i < genealogy.edges.size(); ++i) {
+    edges(i, 0) = JUNCTION::decode(genealogy.edges[i].left);
+    edges(i, 1) = JUNCTION::decode(genealogy.edges[i].right);
+    edges(i, 2) = genealogy.edges[i].parent;
+    edges(i, 3) = genealogy.edges[i].child;
+  }
+  return List::create(Named("node_time") = genealogy.node_time,
+                      Named("edges") = edges);
+}
+
+template <typename JUNCTION>
+List simulate_cpp_impl(Rcpp::RObject input_population,
+                       std::string input_file,
+                       NumericMatrix select,
+                       int pop_size,
+                       int number_of_founders,
+                       Rcpp::NumericVector starting_proportions,
+                       int total_runtime,
+                       NumericVector morgan,
+                       bool progress_bar,
+                       bool track_frequency,
+                       NumericVector track_markers,
+                       NumericVector marker_chromosomes,
+                       NumericVector track_generations,
+                       std::string frequency_file,
+                       bool track_junctions,
+                       bool track_haplotypes,
+                       bool multiplicative_selection,
+                       bool record_genealogy,
+                       bool return_handle,
+                       int seed,
+                       int num_threads) {
+
+  if (record_genealogy &&
+      (select(1, 1) >= 0 || track_frequency || track_junctions ||
+       track_haplotypes)) {
+    Rcpp::stop("record_genealogy can not be combined with selection or tracking");
+  }
+
+  // the map length of every chromosome of the genome
+  std::vector<double> map_lengths(morgan.begin(), morgan.end());
+  size_t num_pairs = map_lengths.size();
+  std::vector<int> track_chromosomes;
+  for (int i = 0; i < marker_chromosomes.size(); ++i) {
+    if (marker_chromosomes[i] < 1 || marker_chromosomes[i] > num_pairs) {
+      Rcpp::stop("marker on a chromosome that does not exist");
+    }
+    track_chromosomes.push_back(marker_chromosomes[i] - 1);
+  }
+
+  // the generations in which frequencies are recorded, in increasing order
+  std::vector<int> record_generations(track_generations.begin(),
+                                      track_generations.end());
+  std::sort(record_generations.begin(), record_generations.end());
 
   set_seed(seed);
-  set_poisson(morgan);
 
-  std::vector< Fish > Pop;
+  Population_t<JUNCTION> startPop;
+  startPop.num_chromosome_pairs = num_pairs;
   int number_of_alleles = number_of_founders;
   std::vector<int> founder_labels;
 
-  if (input_population[0] > -1e4) {
-    Pop = convert_NumericVector_to_fishVector(input_population);
+  Population_t<JUNCTION> input;
+  bool has_input = false;
+  if (!input_file.empty()) {
+    // a population file is mapped into memory, rather than passed from R
+    input = read_population_file<JUNCTION>(input_file);
+    has_input = true;
+  } else {
+    has_input = get_input_population(input_population, input);
+  }
 
-    number_of_founders = 0;
-    for (auto it = Pop.begin(); it != Pop.end(); ++it) {
-      update_founder_labels((*it).chromosome1, founder_labels);
-      update_founder_labels((*it).chromosome2, founder_labels);
+  if (has_input) {
+    if (input.num_chromosome_pairs != num_pairs) {
+      Rcpp::stop("the input population has a different number of chromosomes than morgan");
     }
+
+    // all distinct chromosomes are stored in the junction buffer, in order
+    // of appearance
+    number_of_founders = 0;
+    update_founder_labels(input.junctions, founder_labels);
     number_of_alleles = founder_labels.size();
 
-    if (Pop.size() != pop_size) {
+    if (input.size() != pop_size) {
       // the new population has to be seeded from the input!
-      std::vector< Fish > Pop_new;
+      // individuals drawn repeatedly share their chromosomes
       for (int j = 0; j < pop_size; ++j) {
-        int index = random_number(Pop.size());
-        Pop_new.push_back(Pop[index]);
+        int index = random_number(input.size());
+        startPop.add_individual(input, index);
       }
-      std::swap(Pop, Pop_new);
+    } else {
+      startPop.swap(input);
     }
   } else {
     for (int i = 0; i < pop_size; ++i) {
       int founder_1 = draw_random_founder(starting_proportions);
       int founder_2 = draw_random_founder(starting_proportions);
 
-      Fish p1 = Fish( founder_1 );
-      Fish p2 = Fish( founder_2 );
+      Fish_t<JUNCTION> p1 = Fish_t<JUNCTION>( founder_1 );
+      Fish_t<JUNCTION> p2 = Fish_t<JUNCTION>( founder_2 );
 
-      Pop.push_back(mate(p1,p2, morgan));
+      // every chromosome of the genome descends from the same two founders
+      for (size_t c = 0; c < num_pairs; ++c) {
+        startPop.add_individual(mate(p1, p2, map_lengths[c]));
+      }
     }
     for (int i = 0; i < number_of_alleles; ++i) {
       founder_labels.push_back(i);
@@ -192,38 +356,130 @@ List simulate_cpp(Rcpp::NumericVector input_population,
   }
 
   arma::mat frequencies_table;
-
-  if (track_frequency) {
+  // frequencies over time are either streamed to frequency_file, or kept
+  // in frequencies_table
+  std::unique_ptr< frequency_writer > frequency_output;
+
+  if (track_frequency && !frequency_file.empty()) {
+    marker_plan_t<JUNCTION> plan(track_markers, track_chromosomes,
+                                 founder_labels, num_pairs);
+    frequency_output.reset(new frequency_writer(frequency_file, plan.locations,
+                                                plan.chromosomes, plan.labels,
+                                                1));
+  } else if (track_frequency) {
     int number_of_markers = track_markers.size();
-    arma::mat x(number_of_markers * number_of_alleles * total_runtime, 4); // 4 columns: time, loc, anc, type
+    // 4 columns: time, loc, anc, type, and the chromosome with several
+    arma::mat x(number_of_markers * number_of_alleles * record_generations.size(),
+                num_pairs > 1 ? 5 : 4);
     frequencies_table = x;
   }
 
-  arma::mat initial_frequencies = update_all_frequencies_tibble(Pop, track_markers, founder_labels, 0);
+  arma::mat initial_frequencies = update_all_frequencies_tibble(startPop, track_markers, track_chromosomes, founder_labels, 0);
 
   std::vector<double> junctions;
-  std::vector<Fish> outputPop = simulate_Population(Pop,
-                                                    select,
-                                                    pop_size,
-                                                    total_runtime,
-                                                    morgan,
-                                                    progress_bar,
-                                                    frequencies_table,
-                                                    track_frequency,
-                                                    track_markers,
-                                                    track_junctions,
-                                                    junctions,
-                                                    multiplicative_selection,
-                                                    number_of_alleles,
-                                                    founder_labels);
+  std::vector<int> haplotypes;
+  if (record_genealogy) {
+    tree_sequence_t<JUNCTION> genealogy(startPop);
+    simulate_genealogy(genealogy, pop_size, total_runtime, map_lengths,
+                       progress_bar, num_threads);
+    Population_t<JUNCTION> outputPop = genealogy.population();
+    arma::mat final_frequencies = update_all_frequencies_tibble(outputPop,
+                                                                track_markers,
+                                                                track_chromosomes,
+                                                                founder_labels,
+                                                                total_runtime);
+    return List::create( Named("population") = population_output(outputPop,
+                                                                 return_handle),
+                         Named("frequencies") = frequencies_table,
+                         Named("initial_frequencies") = initial_frequencies,
+                         Named("final_frequencies") = final_frequencies,
+                         Named("genealogy") = genealogy_to_list(genealogy));
+  }
+
+  Population_t<JUNCTION> outputPop = simulate_Population(startPop,
+                                                         select,
+                                                         pop_size,
+                                                         total_runtime,
+                                                         map_lengths,
+                                                         progress_bar,
+                                                         frequencies_table,
+                                                         frequency_output.get(),
+                                                         track_frequency,
+                                                         track_markers,
+                                                         track_chromosomes,
+                                                         record_generations,
+                                                         track_junctions,
+                                                         junctions,
+                                                         track_haplotypes,
+                                                         haplotypes,
+                                                         multiplicative_selection,
+                                                         number_of_alleles,
+                                                         founder_labels,
+                                                         num_threads);
   arma::mat final_frequencies = update_all_frequencies_tibble(outputPop,
                                                               track_markers,
+                                                              track_chromosomes,
                                                               founder_labels,
                                                               total_runtime);
 
-  return List::create( Named("population") = convert_to_list(outputPop),
+  return List::create( Named("population") = population_output(outputPop,
+                                                               return_handle),
                        Named("frequencies") = frequencies_table,
                        Named("initial_frequencies") = initial_frequencies,
                        Named("final_frequencies") = final_frequencies,
-                       Named("junctions") = junctions);
-}
\ No newline at end of file
+                       Named("junctions") = junctions,
+                       Named("haplotypes") = haplotypes);
+}
+// [[Rcpp::export]]
+List simulate_cpp(Rcpp::RObject input_population,
+                  std::string input_file,
+                  NumericMatrix select,
+                  int pop_size,
+                  int number_of_founders,
+                  Rcpp::NumericVector starting_proportions,
+                  int total_runtime,
+                  NumericVector morgan,
+                  bool progress_bar,
+                  bool track_frequency,
+                  NumericVector track_markers,
+                  NumericVector marker_chromosomes,
+                  NumericVector track_generations,
+                  std::string frequency_file,
+                  bool track_junctions,
+                  bool track_haplotypes,
+                  bool multiplicative_selection,
+                  bool record_genealogy,
+                  bool return_handle,
+                  int seed,
+                  int fixed_point_bits,
+                  int num_threads) {
+
+  switch (fixed_point_bits) {
+    case 0:
+      return simulate_cpp_impl<junction>(
+          input_population, input_file, select, pop_size, number_of_founders,
+          starting_proportions, total_runtime, morgan, progress_bar,
+          track_frequency, track_markers, marker_chromosomes, track_generations,
+          frequency_file, track_junctions, track_haplotypes,
+          multiplicative_selection, record_genealogy, return_handle, seed,
+          num_threads);
+    case 32:
+      return simulate_cpp_impl<junction_fixed32>(
+          input_population, input_file, select, pop_size, number_of_founders,
+          starting_proportions, total_runtime, morgan, progress_bar,
+          track_frequency, track_markers, marker_chromosomes, track_generations,
+          frequency_file, track_junctions, track_haplotypes,
+          multiplicative_selection, record_genealogy, return_handle, seed,
+          num_threads);
+    case 64:
+      return simulate_cpp_impl<junction_fixed64>(
+          input_population, input_file, select, pop_size, number_of_founders,
+          starting_proportions, total_runtime, morgan, progress_bar,
+          track_frequency, track_markers, marker_chromosomes, track_generations,
+          frequency_file, track_junctions, track_haplotypes,
+          multiplicative_selection, record_genealogy, return_handle, seed,
+          num_threads);
+  }
+  Rcpp::stop("fixed_point_bits has to be 0, 32 or 64");
+  return List();
+}
@@ -12,6 +12,8 @@
 #include <numeric>
 #include <cmath>
 #include <assert.h>
+#include <memory>
+#include <string>
 
 #include <vector>
 #include <algorithm>
@@ -19,151 +21,162 @@
 #include "Fish.h"
 #include "random_functions.h"
 #include "helper_functions.h"
+#include "Population.h"
+#include "offspring.h"
+#include "frequency_file.h"
+#include "population_handle.h"
+#include "fst.h"
 
 #include <RcppArmadillo.h>
 // [[Rcpp::depends("RcppArmadillo")]]
 using namespace Rcpp;
 
-Fish draw_parent(const std::vector< Fish>& pop_1,
-                 const std::vector< Fish>& pop_2,
-                 double migration_rate,
-                 bool use_selection,
-                 std::vector< double > fitness_source,
-                 std::vector< double > fitness_migr,
-                 double max_fitness_source,
-                 double max_fitness_migr,
-                 int &index) {
-
-  Fish parent;
+template <typename JUNCTION>
+const Population_t<JUNCTION>& draw_parent(const Population_t<JUNCTION>& pop_1,
+                                          const Population_t<JUNCTION>& pop_2,
+                                          double migration_rate,
+                                          bool use_selection,
+                                          const alias_table& sampler_source,
+                                          const alias_table& sampler_migr,
+                                          int &index,
+                                          int &parent_index) {
+
   index = -1;
 
   if (uniform() < migration_rate) {
     // migration
     if(use_selection) {
-      index = draw_prop_fitness(fitness_migr, max_fitness_migr);
+      index = sampler_migr.draw();
     } else {
       index = random_number( (int)pop_2.size() );
     }
     assert(index < pop_2.size());
-    parent = pop_2[index];
+    parent_index = index;
     index = index + pop_1.size();
     // to ensure different indices for pop_1 and pop_2
+    return(pop_2);
+  }
+
+  if(use_selection)  {
+    index = sampler_source.draw();
   } else {
-    if(use_selection)  {
-      index = draw_prop_fitness(fitness_source, max_fitness_source);
-    } else {
-      index = random_number( (int)pop_1.size() );
-    }
-    assert(index < pop_1.size());
-    parent = pop_1[index];
+    index = random_number( (int)pop_1.size() );
   }
-  return(parent);
+  assert(index < pop_1.size());
+  parent_index = index;
+  return(pop_1);
 }
 
 
 
-std::vector< Fish > next_pop_migr(const std::vector< Fish>& pop_1,
-                                  const std::vector< Fish>& pop_2,
-                                  int pop_size,
-                                  std::vector< double > fitness_source,
-                                  std::vector< double > fitness_migr,
-                                  double max_fitness_source,
-                                  double max_fitness_migr,
-                                  const NumericMatrix& select,
-                                  bool use_selection,
-                                  bool multiplicative_selection,
-                                  double migration_rate,
-                                  std::vector< double >& new_fitness,
-                                  double& new_max_fitness,
-                                  double size_in_morgan) {
-
-  std::vector<Fish> new_generation(pop_size);
-  new_fitness.clear();
-  new_fitness.resize(pop_size);
-  new_max_fitness = -1.0;
+template <typename JUNCTION>
+void next_pop_migr(const Population_t<JUNCTION>& pop_1,
+                   const Population_t<JUNCTION>& pop_2,
+                   int pop_size,
+                   const alias_table& sampler_source,
+                   const alias_table& sampler_migr,
+                   const selection_plan_t<JUNCTION>& selection_plan,
+                   bool use_selection,
+                   double migration_rate,
+                   Population_t<JUNCTION>& new_generation,
+                   std::vector< double >& new_fitness,
+                   double size_in_morgan,
+                   int num_threads,
+                   std::vector< Population_t<JUNCTION> >& thread_buffers,
+                   int generation,
+                   int population,
+                   int first_individual) {
+
+  set_stream(generation, parent_stream, population);
+  std::vector< mating_t<JUNCTION> > matings;
+  matings.reserve(pop_size);
   for (int i = 0; i < pop_size; ++i)  {
     int index1, index2;
-    Fish parent1 = draw_parent(pop_1, pop_2, migration_rate,
-                               use_selection,
-                               fitness_source, fitness_migr,
-                               max_fitness_source, max_fitness_migr,
-                               index1);
-    Fish parent2 = draw_parent(pop_1, pop_2, migration_rate,
-                               use_selection,
-                               fitness_source, fitness_migr,
-                               max_fitness_source, max_fitness_migr,
-                               index2);
+    int parent_index1, parent_index2;
+    const Population_t<JUNCTION>* parent1 = &draw_parent(pop_1, pop_2, migration_rate,
+                                                         use_selection,
+                                                         sampler_source, sampler_migr,
+                                                         index1, parent_index1);
+    const Population_t<JUNCTION>* parent2 = &draw_parent(pop_1, pop_2, migration_rate,
+                                                         use_selection,
+                                                         sampler_source, sampler_migr,
+                                                         index2, parent_index2);
     while (index1 == index2) {
-      parent2 = draw_parent(pop_1, pop_2, migration_rate,
-                            use_selection,
-                            fitness_source, fitness_migr,
-                            max_fitness_source, max_fitness_migr,
-                            index2);
+      parent2 = &draw_parent(pop_1, pop_2, migration_rate,
+                             use_selection,
+                             sampler_source, sampler_migr,
+                             index2, parent_index2);
     }
 
-    new_generation[i] = mate(parent1, parent2, size_in_morgan);
-
-    double fit = -2.0;
-    if (use_selection) fit = calculate_fitness(new_generation[i], select, multiplicative_selection);
-    if (fit > new_max_fitness) new_max_fitness = fit;
-
-    new_fitness[i] = fit;
+    matings.push_back(mating_t<JUNCTION>(*parent1, parent_index1,
+                                         *parent2, parent_index2));
   }
-  return new_generation;
+
+  // migration is simulated for a genome of a single chromosome
+  generate_offspring(matings, generation, first_individual,
+                     std::vector<double>(1, size_in_morgan),
+                     selection_plan, use_selection,
+                     num_threads, thread_buffers,
+                     new_generation, new_fitness);
+  return;
 }
 
-std::vector< std::vector< Fish > > simulate_two_populations(
-    const std::vector< Fish>& source_pop_1,
-    const std::vector< Fish>& source_pop_2,
+template <typename JUNCTION>
+std::vector< Population_t<JUNCTION> > simulate_two_populations(
+    const Population_t<JUNCTION>& source_pop_1,
+    const Population_t<JUNCTION>& source_pop_2,
     const NumericMatrix& select,
     const NumericVector& pop_size,
     int total_runtime,
     double morgan,
     bool progress_bar,
     arma::mat& frequencies,
+    frequency_writer* frequency_file,
     bool track_frequency,
     const NumericVector& track_markers,
+    const std::vector<int>& track_generations,
     bool track_junctions,
     std::vector<double>& junctions,
     bool multiplicative_selection,
     int num_alleles,
     const std::vector<int>& founder_labels,
-    double migration_rate) {
+    double migration_rate,
+    fst_monitor_t* fst_monitor,
+    int num_threads) {
   bool use_selection = FALSE;
   if (select(1, 1) >= 0) use_selection = TRUE;
 
-  std::vector<Fish> pop_1 = source_pop_1;
-  std::vector<Fish> pop_2 = source_pop_2;
+  // current and next generation of both populations, the memory of
+  // the next generation is reused across generations
+  Population_t<JUNCTION> pop_1 = source_pop_1;
+  Population_t<JUNCTION> pop_2 = source_pop_2;
+  Population_t<JUNCTION> new_generation_pop_1;
+  Population_t<JUNCTION> new_generation_pop_2;
+  std::vector< Population_t<JUNCTION> > thread_buffers;
 
-  double max_fitness_pop_1, max_fitness_pop_2;
   std::vector<double> fitness_pop_1, fitness_pop_2;
+  alias_table sampler_pop_1, sampler_pop_2;
+  selection_plan_t<JUNCTION> selection_plan(select, multiplicative_selection);
 
   if (use_selection) {
-    for (int j = 0; j < select.nrow(); ++j) {
-      if (select(j, 4) < 0) break; // these entries are only for tracking, not for selection calculations
-      double local_max_fitness = 0.0;
-      for (int i = 1; i < 4; ++i) {
-        if (select(j, i) > local_max_fitness) {
-          local_max_fitness = select(j, i);
-        }
-      }
-    }
-
-    for (auto it = pop_1.begin(); it != pop_1.end(); ++it){
-      double fit = calculate_fitness((*it), select, multiplicative_selection);
-      if (fit > max_fitness_pop_1) max_fitness_pop_1 = fit;
+    find_selected_alleles(pop_1, selection_plan);
+    find_selected_alleles(pop_2, selection_plan);
 
+    for (size_t i = 0; i < pop_1.size(); ++i){
+      double fit = calculate_fitness(pop_1, i, selection_plan);
       fitness_pop_1.push_back(fit);
     }
 
-    for (auto it = pop_2.begin(); it != pop_2.end(); ++it){
-      double fit = calculate_fitness((*it), select, multiplicative_selection);
-      if (fit > max_fitness_pop_2) max_fitness_pop_2 = fit;
-
+    for (size_t i = 0; i < pop_2.size(); ++i){
+      double fit = calculate_fitness(pop_2, i, selection_plan);
       fitness_pop_2.push_back(fit);
     }
   }
 
+  marker_plan_t<JUNCTION> marker_plan(track_markers, std::vector<int>(),
+                                      founder_labels, 1);
+  size_t next_record = 0;
+
   int updateFreq = total_runtime / 20;
   if(updateFreq < 1) updateFreq = 1;
 
@@ -174,75 +187,92 @@ std::vector< std::vector< Fish > > simulate_two_populations(
   R_FlushConsole();
 
   for (int t = 0; t < total_runtime; ++t) {
-    if(track_frequency) {
-      arma::mat local_mat = update_all_frequencies_tibble_dual_pop (pop_1,
-                                                                    pop_2,
-                                                                    track_markers,
-                                                                    founder_labels,
-                                                                    t);
-      int num_founder_labels = founder_labels.size();
-      int num_markers = track_markers.size();
-      int local_mat_size = num_founder_labels * num_markers * 2;
-
-      int start_add_marker = local_mat_size * t;
-
-      for (int j = 0; j < local_mat_size; ++j) {
-        for (int k = 0; k < 5; ++k) {
-          frequencies(start_add_marker + j, k)  = local_mat(j, k);
-        }
+    // the average over the chromosomes of both populations
+    if (track_junctions) {
+      double chromosomes_1 = pop_1.num_chromosomes();
+      double chromosomes_2 = pop_2.num_chromosomes();
+      junctions.push_back((calc_mean_junctions(pop_1) * chromosomes_1 +
+                           calc_mean_junctions(pop_2) * chromosomes_2) /
+                          (chromosomes_1 + chromosomes_2));
+    }
+
+    // frequencies are recorded in the generations in track_generations
+    if(track_frequency && next_record < track_generations.size() &&
+       track_generations[next_record] == t) {
+      if(frequency_file) {
+        write_frequencies(*frequency_file, marker_plan, t, pop_1, pop_2);
+      } else {
+        record_frequencies_dual_pop(pop_1, pop_2, marker_plan, t, frequencies,
+                                    2 * next_record * marker_plan.num_rows());
       }
+      next_record++;
     }
 
-    double new_max_fitness_pop_1, new_max_fitness_pop_2;
     std::vector<double> new_fitness_pop_1, new_fitness_pop_2;
     assert(pop_size.size() == 2);
 
-    std::vector<Fish> new_generation_pop_1 = next_pop_migr(pop_1, // resident
-                                                           pop_2, // migrants
-                                                           pop_size[0],
-                                                           fitness_pop_1,
-                                                           fitness_pop_2,
-                                                           max_fitness_pop_1,
-                                                           max_fitness_pop_2,
-                                                           select,
-                                                           use_selection,
-                                                           multiplicative_selection,
-                                                           migration_rate,
-                                                           new_fitness_pop_1,
-                                                           new_max_fitness_pop_1,
-                                                           morgan);
-
-    std::vector<Fish> new_generation_pop_2 = next_pop_migr(pop_2,  // resident
-                                                           pop_1,  // migrants
-                                                           pop_size[1],
-                                                           fitness_pop_2,
-                                                           fitness_pop_1,
-                                                           max_fitness_pop_2,
-                                                           max_fitness_pop_1,
-                                                           select,
-                                                           use_selection,
-                                                           multiplicative_selection,
-                                                           migration_rate,
-                                                           new_fitness_pop_2,
-                                                           new_max_fitness_pop_2,
-                                                           morgan);
+    if (use_selection) {
+      sampler_pop_1.build(fitness_pop_1, multiplicative_selection);
+      sampler_pop_2.build(fitness_pop_2, multiplicative_selection);
+    }
+
+    next_pop_migr(pop_1, // resident
+                  pop_2, // migrants
+                  pop_size[0],
+                  sampler_pop_1,
+                  sampler_pop_2,
+                  selection_plan,
+                  use_selection,
+                  migration_rate,
+                  new_generation_pop_1,
+                  new_fitness_pop_1,
+                  morgan,
+                  num_threads,
+                  thread_buffers,
+                  t,
+                  1,  // population
+                  0); // first individual
+
+    next_pop_migr(pop_2,  // resident
+                  pop_1,  // migrants
+                  pop_size[1],
+                  sampler_pop_2,
+                  sampler_pop_1,
+                  selection_plan,
+                  use_selection,
+                  migration_rate,
+                  new_generation_pop_2,
+                  new_fitness_pop_2,
+                  morgan,
+                  num_threads,
+                  thread_buffers,
+                  t,
+                  2,  // population
+                  pop_size[0]); // first individual
     // Rcout << "updating vectors\n";
-    pop_1 = new_generation_pop_1;
-    pop_2 = new_generation_pop_2;
-    fitness_pop_1 = new_fitness_pop_1;
-    fitness_pop_2 = new_fitness_pop_2;
-    max_fitness_pop_1 = new_max_fitness_pop_1;
-    max_fitness_pop_2 = new_max_fitness_pop_2;
+    pop_1.swap(new_generation_pop_1);
+    pop_2.swap(new_generation_pop_2);
+    fitness_pop_1.swap(new_fitness_pop_1);
+    fitness_pop_2.swap(new_fitness_pop_2);
 
     if (t % updateFreq == 0 && progress_bar) {
       Rcout << "**";
     }
 
+    if (fst_monitor && fst_monitor->is_due(t + 1, total_runtime) &&
+        fst_monitor->update(pop_1, pop_2, t)) {
+      break;
+    }
+
     // Rcout << "checking for fixation\n";
     if (t > 1 && is_fixed(pop_1) && is_fixed(pop_2)) {
       Rcout << "\n After " << t << " generations, the population has become completely homozygous and fixed\n";
       R_FlushConsole();
-      std::vector< std::vector < Fish > > output;
+      if (fst_monitor && (fst_monitor->generations.empty() ||
+                          fst_monitor->generations.back() != t + 1)) {
+        fst_monitor->update(pop_1, pop_2, t);
+      }
+      std::vector< Population_t<JUNCTION> > output;
       output.push_back(pop_1);
       output.push_back(pop_2);
       return(output);
@@ -251,70 +281,83 @@ std::vector< std::vector< Fish > > simulate_two_populations(
     Rcpp::checkUserInterrupt();
   }
   if (progress_bar) Rcout << "\n";
-  std::vector< std::vector< Fish > > output;
+  std::vector< Population_t<JUNCTION> > output;
   output.push_back(pop_1);
   output.push_back(pop_2);
   return(output);
 }
 
-// [[Rcpp::export]]
-List simulate_migration_cpp(NumericVector input_population_1,
-                            NumericVector input_population_2,
-                            NumericMatrix select,
-                            NumericVector pop_size,
-                            NumericMatrix starting_frequencies,
-                            int total_runtime,
-                            double morgan,
-                            bool progress_bar,
-                            bool track_frequency,
-                            NumericVector track_markers,
-                            bool track_junctions,
-                            bool multiplicative_selection,
-                            double migration_rate,
-                            int seed) {
+template <typename JUNCTION>
+List simulate_migration_cpp_impl(Rcpp::RObject input_population_1,
+                                 Rcpp::RObject input_population_2,
+                                 NumericMatrix select,
+                                 NumericVector pop_size,
+                                 NumericMatrix starting_frequencies,
+                                 int total_runtime,
+                                 double morgan,
+                                 bool progress_bar,
+                                 bool track_frequency,
+                                 NumericVector track_markers,
+                                 NumericVector track_generations,
+                                 std::string frequency_file,
+                                 bool track_junctions,
+                                 bool multiplicative_selection,
+                                 double migration_rate,
+                                 bool return_handle,
+                                 int seed,
+                                 fst_monitor_t* fst_monitor,
+                                 int num_threads) {
+  // the generations in which frequencies are recorded, in increasing order
+  std::vector<int> record_generations(track_generations.begin(),
+                                      track_generations.end());
+  std::sort(record_generations.begin(), record_generations.end());
+
   set_seed(seed);
-  set_poisson(morgan);
 
-  std::vector< Fish > Pop_1;
-  std::vector< Fish > Pop_2;
+  std::vector< Fish_t<JUNCTION> > Pop_1;
+  std::vector< Fish_t<JUNCTION> > Pop_2;
+  Population_t<JUNCTION> start_pop_1;
+  Population_t<JUNCTION> start_pop_2;
   int number_of_alleles = -1;
   std::vector<int> founder_labels;
 
-  if (input_population_1[0] > -1e4) {
+  Population_t<JUNCTION> input_1;
+  Population_t<JUNCTION> input_2;
+  if (get_input_population(input_population_1, input_1)) {
     Rcout << "Found input populations! converting!\n";  R_FlushConsole();
 
-    Pop_1 = convert_NumericVector_to_fishVector(input_population_1);
-    Pop_2 = convert_NumericVector_to_fishVector(input_population_2);
-
-    for (auto it = Pop_1.begin(); it != Pop_1.end(); ++it) {
-      update_founder_labels((*it).chromosome1, founder_labels);
-      update_founder_labels((*it).chromosome2, founder_labels);
+    if (!get_input_population(input_population_2, input_2)) {
+      Rcpp::stop("both input populations have to be provided");
     }
-
-    for (auto it = Pop_2.begin(); it != Pop_2.end(); ++it) {
-      update_founder_labels((*it).chromosome1, founder_labels);
-      update_founder_labels((*it).chromosome2, founder_labels);
+    if (input_1.num_chromosome_pairs != 1 || input_2.num_chromosome_pairs != 1) {
+      Rcpp::stop("migration can only be simulated for a single chromosome");
     }
 
+    // all distinct chromosomes are stored in the junction buffer, in order
+    // of appearance
+    update_founder_labels(input_1.junctions, founder_labels);
+    update_founder_labels(input_2.junctions, founder_labels);
+
     number_of_alleles = founder_labels.size();
 
-    if (Pop_1.size() != pop_size[0]) {
+    if (input_1.size() != pop_size[0]) {
       // the populations have to be populated from the parents!
-      std::vector< Fish > Pop_1_new;
+      // individuals drawn repeatedly share their chromosomes
       for(int j = 0; j < pop_size[0]; ++j) {
-        int index = random_number(Pop_1.size());
-        Pop_1_new.push_back(Pop_1[index]);
+        int index = random_number(input_1.size());
+        start_pop_1.add_individual(input_1, index);
       }
-      std::swap(Pop_1, Pop_1_new);
+    } else {
+      start_pop_1.swap(input_1);
     }
 
-    if (Pop_2.size() != pop_size[1]) {
-      std::vector< Fish > Pop_2_new;
+    if (input_2.size() != pop_size[1]) {
       for (int j = 0; j < pop_size[1]; ++j) {
-        int index = random_number(Pop_2.size());
-        Pop_2_new.push_back(Pop_2[index]);
+        int index = random_number(input_2.size());
+        start_pop_2.add_individual(input_2, index);
       }
-      std::swap(Pop_2, Pop_2_new);
+    } else {
+      start_pop_2.swap(input_2);
     }
   } else {
 
@@ -325,8 +368,8 @@ List simulate_migration_cpp(NumericVector input_population_1,
         int founder_1 = draw_random_founder(focal_freqs);
         int founder_2 = draw_random_founder(focal_freqs);
 
-        Fish p1 = Fish( founder_1 );
-        Fish p2 = Fish( founder_2 );
+        Fish_t<JUNCTION> p1 = Fish_t<JUNCTION>( founder_1 );
+        Fish_t<JUNCTION> p2 = Fish_t<JUNCTION>( founder_2 );
 
         if(j == 0) Pop_1.push_back(mate(p1,p2, morgan));
         if(j == 1) Pop_2.push_back(mate(p1,p2, morgan));
@@ -336,48 +379,198 @@ List simulate_migration_cpp(NumericVector input_population_1,
       founder_labels.push_back(i);
     }
     number_of_alleles = founder_labels.size();
+    start_pop_1 = Population_t<JUNCTION>(Pop_1);
+    start_pop_2 = Population_t<JUNCTION>(Pop_2);
   }
 
-  int number_of_markers = track_markers.size();
-  // 5 columns: time, loc, anc, type, population
-  arma::mat frequencies_table(number_of_markers * number_of_alleles * total_runtime * 2, 5);
-  arma::mat initial_frequencies = update_all_frequencies_tibble_dual_pop(Pop_1,
-                                                                         Pop_2,
+  // frequencies over time are either streamed to frequency_file, or kept
+  // in frequencies_table
+  arma::mat frequencies_table;
+  std::unique_ptr< frequency_writer > frequency_output;
+  if (track_frequency && !frequency_file.empty()) {
+    marker_plan_t<JUNCTION> plan(track_markers, std::vector<int>(),
+                                 founder_labels, 1);
+    frequency_output.reset(new frequency_writer(frequency_file, plan.locations,
+                                                plan.chromosomes, plan.labels,
+                                                2));
+  } else if (track_frequency) {
+    int number_of_markers = track_markers.size();
+    // 5 columns: time, loc, anc, type, population
+    frequencies_table.zeros(number_of_markers * number_of_alleles *
+                            record_generations.size() * 2, 5);
+  }
+  arma::mat initial_frequencies = update_all_frequencies_tibble_dual_pop(start_pop_1,
+                                                                         start_pop_2,
                                                                          track_markers,
                                                                          founder_labels,
                                                                          0);
 
   std::vector<double> junctions;
   Rcout << "starting simulation\n"; R_FlushConsole();
-  std::vector< std::vector< Fish> > output_populations;
+  std::vector< Population_t<JUNCTION> > output_populations;
 
-  output_populations = simulate_two_populations(Pop_1,
-                                                Pop_2,
+  output_populations = simulate_two_populations(start_pop_1,
+                                                start_pop_2,
                                                 select,
                                                 pop_size,
                                                 total_runtime,
                                                 morgan,
                                                 progress_bar,
                                                 frequencies_table,
+                                                frequency_output.get(),
                                                 track_frequency,
                                                 track_markers,
+                                                record_generations,
                                                 track_junctions,
                                                 junctions,
                                                 multiplicative_selection,
                                                 number_of_alleles,
                                                 founder_labels,
-                                                migration_rate);
+                                                migration_rate,
+                                                fst_monitor,
+                                                num_threads);
   Rcout << "finished simulation\n";
+
+  int generations_simulated = total_runtime;
+  if (fst_monitor && !fst_monitor->generations.empty()) {
+    generations_simulated = fst_monitor->generations.back();
+    // frequencies are only recorded for the generations simulated
+    if (track_frequency && !frequency_output) {
+      size_t recorded = std::lower_bound(record_generations.begin(),
+                                         record_generations.end(),
+                                         generations_simulated) -
+                        record_generations.begin();
+      frequencies_table.resize(recorded * 2 * track_markers.size() *
+                               number_of_alleles, 5);
+    }
+  }
+
   arma::mat final_frequencies = update_all_frequencies_tibble_dual_pop(output_populations[0],
                                                                        output_populations[1],
                                                                                          track_markers,
                                                                                          founder_labels,
-                                                                                         total_runtime);
-
-  return List::create( Named("population_1") = convert_to_list(output_populations[0]),
-                       Named("population_2") = convert_to_list(output_populations[1]),
-                       Named("frequencies") = frequencies_table,
-                       Named("initial_frequencies") = initial_frequencies,
-                       Named("final_frequencies") = final_frequencies,
-                       Named("junctions") = junctions);
-}
\ No newline at end of file
+                                                                                         generations_simulated);
+
+  List output = List::create( Named("population_1") = population_output(output_populations[0],
+                                                                        return_handle),
+                              Named("population_2") = population_output(output_populations[1],
+                                                                        return_handle),
+                              Named("frequencies") = frequencies_table,
+                              Named("initial_frequencies") = initial_frequencies,
+                              Named("final_frequencies") = final_frequencies,
+                              Named("junctions") = junctions);
+  if (fst_monitor) {
+    NumericMatrix fst(fst_monitor->fst.size(), 2);
+    for (size_t i = 0; i < fst_monitor->fst.size(); ++i) {
+      fst(i, 0) = fst_monitor->generations[i];
+      fst(i, 1) = fst_monitor->fst[i];
+    }
+    output.push_back(fst, "fst");
+  }
+  return output;
+}
+// [[Rcpp::export]]
+List simulate_migration_cpp(Rcpp::RObject input_population_1,
+                            Rcpp::RObject input_population_2,
+                            NumericMatrix select,
+                            NumericVector pop_size,
+                            NumericMatrix starting_frequencies,
+                            int total_runtime,
+                            double morgan,
+                            bool progress_bar,
+                            bool track_frequency,
+                            NumericVector track_markers,
+                            NumericVector track_generations,
+                            std::string frequency_file,
+                            bool track_junctions,
+                            bool multiplicative_selection,
+                            double migration_rate,
+                            bool return_handle,
+                            int seed,
+                            int fixed_point_bits,
+                            int num_threads) {
+
+  switch (fixed_point_bits) {
+    case 0:
+      return simulate_migration_cpp_impl<junction>(
+          input_population_1, input_population_2, select, pop_size,
+          starting_frequencies, total_runtime, morgan, progress_bar,
+          track_frequency, track_markers, track_generations, frequency_file,
+          track_junctions, multiplicative_selection, migration_rate,
+          return_handle, seed, 0, num_threads);
+    case 32:
+      return simulate_migration_cpp_impl<junction_fixed32>(
+          input_population_1, input_population_2, select, pop_size,
+          starting_frequencies, total_runtime, morgan, progress_bar,
+          track_frequency, track_markers, track_generations, frequency_file,
+          track_junctions, multiplicative_selection, migration_rate,
+          return_handle, seed, 0, num_threads);
+    case 64:
+      return simulate_migration_cpp_impl<junction_fixed64>(
+          input_population_1, input_population_2, select, pop_size,
+          starting_frequencies, total_runtime, morgan, progress_bar,
+          track_frequency, track_markers, track_generations, frequency_file,
+          track_junctions, multiplicative_selection, migration_rate,
+          return_handle, seed, 0, num_threads);
+  }
+  Rcpp::stop("fixed_point_bits has to be 0, 32 or 64");
+  return List();
+}
+
+// as simulate_migration_cpp, stopping as soon as the Fst between the
+// populations, estimated every generations_between_update generations,
+// reaches critical_fst
+// [[Rcpp::export]]
+List simulate_migration_until_cpp(Rcpp::RObject input_population_1,
+                                  Rcpp::RObject input_population_2,
+                                  NumericMatrix select,
+                                  NumericVector pop_size,
+                                  NumericMatrix starting_frequencies,
+                                  int total_runtime,
+                                  double morgan,
+                                  bool progress_bar,
+                                  bool track_frequency,
+                                  NumericVector track_markers,
+                                  NumericVector track_generations,
+                                  bool track_junctions,
+                                  bool multiplicative_selection,
+                                  double migration_rate,
+                                  int generations_between_update,
+                                  double critical_fst,
+                                  int sampled_individuals,
+                                  int number_of_markers,
+                                  bool random_markers,
+                                  bool return_handle,
+                                  int seed,
+                                  int fixed_point_bits,
+                                  int num_threads) {
+  fst_monitor_t fst_monitor(generations_between_update, critical_fst,
+                            sampled_individuals, number_of_markers,
+                            random_markers, progress_bar);
+
+  switch (fixed_point_bits) {
+    case 0:
+      return simulate_migration_cpp_impl<junction>(
+          input_population_1, input_population_2, select, pop_size,
+          starting_frequencies, total_runtime, morgan, false,
+          track_frequency, track_markers, track_generations, "",
+          track_junctions, multiplicative_selection, migration_rate,
+          return_handle, seed, &fst_monitor, num_threads);
+    case 32:
+      return simulate_migration_cpp_impl<junction_fixed32>(
+          input_population_1, input_population_2, select, pop_size,
+          starting_frequencies, total_runtime, morgan, false,
+          track_frequency, track_markers, track_generations, "",
+          track_junctions, multiplicative_selection, migration_rate,
+          return_handle, seed, &fst_monitor, num_threads);
+    case 64:
+      return simulate_migration_cpp_impl<junction_fixed64>(
+          input_population_1, input_population_2, select, pop_size,
+          starting_frequencies, total_runtime, morgan, false,
+          track_frequency, track_markers, track_generations, "",
+          track_junctions, multiplicative_selection, migration_rate,
+          return_handle, seed, &fst_monitor, num_threads);
+  }
+  Rcpp::stop("fixed_point_bits has to be 0, 32 or 64");
+  return List();
+}
@@ -0,0 +1,188 @@
+//
+//  tajima_d.cpp
+//
+//
+//  Nucleotide diversity and segregating sites, per marker, from the ancestry
+//  counts of sampled chromosomes. Of n chromosomes of which c_u carry
+//  ancestry u at a marker, a fraction 1 - sum_u c_u (c_u - 1) / (n (n - 1))
+//  of all pairs differ at that marker, such that pi follows from the counts
+//  without comparing chromosomes pairwise.
+//
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "population_handle.h"
+#include "helper_functions.h"
+
+namespace {
+
+template <typename JUNCTION>
+Rcpp::NumericMatrix diversity_per_marker(const population_handle& handle,
+                                         const Rcpp::IntegerVector& individuals,
+                                         const Rcpp::NumericVector& markers) {
+    Population_t<JUNCTION> converted;
+    const Population_t<JUNCTION>* pop = handle.find<JUNCTION>();
+    if(!pop) {
+        converted = handle.get<JUNCTION>();
+        pop = &converted;
+    }
+    marker_plan_t<JUNCTION> plan(markers, std::vector<int>(), std::vector<int>(),
+                                 pop->num_chromosome_pairs);
+
+    size_t num_markers = markers.size();
+    std::vector< std::vector< int > > labels(num_markers);
+    std::vector< std::vector< double > > counts(num_markers);
+    std::vector< int > genotype(2 * num_markers);
+    for(int i = 0; i < individuals.size(); ++i) {
+        if(individuals[i] < 0 || individuals[i] >= (int)pop->size()) {
+            Rcpp::stop("individual not in population");
+        }
+        genotype_individual(*pop, individuals[i], plan, genotype.data());
+        for(size_t m = 0; m < num_markers; ++m) {
+            for(size_t h = 0; h < 2; ++h) {
+                // markers at or beyond the end of a chromosome (-1) are
+                // counted as an ancestry of their own
+                int label = genotype[2 * m + h];
+                size_t allele = std::find(labels[m].begin(), labels[m].end(),
+                                          label) - labels[m].begin();
+                if(allele == labels[m].size()) {
+                    labels[m].push_back(label);
+                    counts[m].push_back(0.0);
+                }
+                counts[m][allele] += 1.0;
+            }
+        }
+    }
+
+    // pi and whether the marker is segregating
+    double n = 2.0 * individuals.size();
+    Rcpp::NumericMatrix output(num_markers, 2);
+    for(size_t m = 0; m < num_markers; ++m) {
+        double same = 0.0;
+        for(auto it = counts[m].begin(); it != counts[m].end(); ++it) {
+            same += (*it) * (*it - 1);
+        }
+        output(m, 0) = n > 1 ? 1.0 - same / (n * (n - 1)) : 0.0;
+        output(m, 1) = labels[m].size() > 1 ? 1.0 : 0.0;
+    }
+    return output;
+}
+
+Rcpp::NumericMatrix diversity_per_marker(const Rcpp::RObject& population,
+                                         const Rcpp::IntegerVector& individuals,
+                                         const Rcpp::NumericVector& markers) {
+    population_ptr handle = get_population_handle(population);
+    switch(handle->fixed_point_bits) {
+        case 32: return diversity_per_marker<junction_fixed32>(*handle,
+                                                               individuals,
+                                                               markers);
+        case 64: return diversity_per_marker<junction_fixed64>(*handle,
+                                                               individuals,
+                                                               markers);
+    }
+    return diversity_per_marker<junction>(*handle, individuals, markers);
+}
+
+// Tajima's D, theta estimated from S and the two-sided p value of D under
+// the beta distribution of Tajima (1989), for n sampled chromosomes
+struct tajima_d_t {
+    double d;
+    double theta_hat;
+    double p;
+
+    tajima_d_t(double pi, double s, double n) {
+        double a1 = 0.0, a2 = 0.0;
+        for(int i = 1; i < n; ++i) {
+            a1 += 1.0 / i;
+            a2 += 1.0 / (1.0 * i * i);
+        }
+        double b1 = (n + 1) / (3 * (n - 1));
+        double b2 = 2 * (n * n + n + 3) / (9 * n * (n - 1));
+        double c1 = b1 - 1 / a1;
+        double c2 = b2 - (n + 2) / (a1 * n) + a2 / (a1 * a1);
+        double e1 = c1 / a1;
+        double e2 = c2 / (a1 * a1 + a2);
+
+        theta_hat = s / a1;
+        d = (pi - theta_hat) / std::sqrt(e1 * s + e2 * s * (s - 1));
+
+        double d_min = (2 / n - 1 / a1) / std::sqrt(e2);
+        double d_max = ((n + 1) / (2 * n) - 1 / a1) / std::sqrt(e2);
+        double alpha = -(1 + d_min * d_max) * d_max / (d_max - d_min);
+        double beta = (1 + d_min * d_max) * d_min / (d_max - d_min);
+        p = R::pbeta((d - d_min) / (d_max - d_min), beta, alpha, 1, 0);
+        if(!std::isnan(p)) {
+            p = p < 0.5 ? 2 * p : 2 * (1 - p);
+        }
+    }
+};
+
+}
+
+// Tajima's D of the listed individuals, over all markers if window_size is
+// not positive, else per window of window_size Morgan, starting every
+// window_step Morgan from 0. Rows hold the window start and end, the number
+// of markers, D, pi, S, theta estimated from S and the p value of D.
+// [[Rcpp::export]]
+Rcpp::NumericMatrix calculate_tajima_d_cpp(Rcpp::RObject population,
+                                           Rcpp::IntegerVector individuals,
+                                           Rcpp::NumericVector markers,
+                                           double window_size,
+                                           double window_step) {
+    if(individuals.size() < 2) {
+        Rcpp::stop("at least two individuals have to be sampled");
+    }
+    if(window_size > 0 && window_step <= 0) {
+        Rcpp::stop("window_step has to be positive");
+    }
+    Rcpp::NumericMatrix diversity = diversity_per_marker(population,
+                                                         individuals,
+                                                         markers);
+
+    // markers in order of location, such that every window is contiguous
+    int num_markers = markers.size();
+    std::vector< int > order(num_markers);
+    for(int i = 0; i < num_markers; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return markers[a] < markers[b];
+    });
+    double last = num_markers > 0 ? markers[order.back()] : 0.0;
+
+    std::vector< double > starts(1, 0.0);
+    std::vector< double > ends(1, last);
+    if(window_size > 0) {
+        starts.clear();
+        ends.clear();
+        for(int w = 0; w == 0 || w * window_step <= last; ++w) {
+            starts.push_back(w * window_step);
+            ends.push_back(w * window_step + window_size);
+        }
+    }
+
+    double n = 2.0 * individuals.size();
+    Rcpp::NumericMatrix output(starts.size(), 8);
+    int first = 0;
+    for(size_t w = 0; w < starts.size(); ++w) {
+        while(first < num_markers && markers[order[first]] < starts[w]) ++first;
+        double pi = 0.0, s = 0.0;
+        int count = 0;
+        for(int i = first; i < num_markers; ++i) {
+            // without windows, all markers are used
+            if(window_size > 0 && markers[order[i]] >= ends[w]) break;
+            pi += diversity(order[i], 0);
+            s += diversity(order[i], 1);
+            count++;
+        }
+        tajima_d_t tajima(pi, s, n);
+        output(w, 0) = starts[w];
+        output(w, 1) = ends[w];
+        output(w, 2) = count;
+        output(w, 3) = tajima.d;
+        output(w, 4) = pi;
+        output(w, 5) = s;
+        output(w, 6) = tajima.theta_hat;
+        output(w, 7) = tajima.p;
+    }
+    return output;
+}
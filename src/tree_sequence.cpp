@@ -0,0 +1,320 @@
+//
+//  tree_sequence.cpp
+//
+//
+
+#include "tree_sequence.h"
+#include <algorithm>
+
+template <typename JUNCTION>
+tree_sequence_t<JUNCTION>::tree_sequence_t(
+    const Population_t<JUNCTION>& founding_population) :
+    founders(founding_population), num_simplified_edges(0) {
+    node_time.assign(founders.num_chromosomes(), 0);
+    for(size_t k = 0; k < founders.num_chromosomes(); ++k) {
+        samples.push_back(k);
+    }
+}
+
+template <typename JUNCTION>
+int tree_sequence_t<JUNCTION>::add_generation(int time, size_t num_chromosomes) {
+    int first = node_time.size();
+    node_time.resize(first + num_chromosomes, time);
+    samples.resize(num_chromosomes);
+    for(size_t k = 0; k < num_chromosomes; ++k) {
+        samples[k] = first + k;
+    }
+    return first;
+}
+
+template <typename JUNCTION>
+void record_meiosis(std::vector< typename tree_sequence_t<JUNCTION>::edge_t >& edges,
+                    int child,
+                    int parent1,
+                    int parent2,
+                    double morgan) {
+    typedef typename tree_sequence_t<JUNCTION>::edge_t edge_t;
+    typedef typename JUNCTION::position_type position_type;
+
+    // breakpoint buffer is reused across meioses
+    static thread_local std::vector< position_type > breakpoints;
+
+    int parent[2] = {parent1, parent2};
+    int focal = draw_meiosis<JUNCTION>(breakpoints, morgan);
+
+    position_type left = JUNCTION::encode(0.0);
+    for(size_t i = 0; i < breakpoints.size(); ++i) {
+        if(breakpoints[i] > left) {
+            edges.push_back(edge_t(left, breakpoints[i], parent[focal], child));
+        }
+        left = breakpoints[i];
+        focal = 1 - focal;
+    }
+    position_type end = JUNCTION::encode(1.0);
+    if(end > left) {
+        edges.push_back(edge_t(left, end, parent[focal], child));
+    }
+}
+
+namespace {
+
+// a segment of a chromosome that is ancestral to node of the simplified
+// genealogy
+template <typename POS>
+struct segment_t {
+    POS left;
+    POS right;
+    int node;
+
+    segment_t(POS l, POS r, int n) : left(l), right(r), node(n) {}
+};
+
+// Splits the overlapping segments into maximal intervals over which the
+// same segments overlap, calling f(left, right, segments) for every interval
+// covered by at least one segment.
+template <typename POS, typename F>
+void for_each_overlap(std::vector< segment_t<POS> >& segments, F f) {
+    if(segments.empty()) return;
+
+    std::sort(segments.begin(), segments.end(),
+              [](const segment_t<POS>& a, const segment_t<POS>& b) {
+                  return a.left < b.left;
+              });
+
+    std::vector< segment_t<POS> > X;
+    size_t n = segments.size();
+    size_t j = 0;
+    POS right = segments[0].left;
+
+    auto drop_before = [&X](POS left) {
+        X.erase(std::remove_if(X.begin(), X.end(),
+                               [left](const segment_t<POS>& x) {
+                                   return x.right <= left;
+                               }), X.end());
+    };
+
+    while(j < n) {
+        POS left = right;
+        drop_before(left);
+        if(X.empty()) left = segments[j].left;
+        while(j < n && segments[j].left == left) {
+            X.push_back(segments[j]);
+            j++;
+        }
+        right = X[0].right;
+        for(size_t i = 1; i < X.size(); ++i) right = std::min(right, X[i].right);
+        if(j < n) right = std::min(right, segments[j].left);
+        f(left, right, X);
+    }
+
+    while(!X.empty()) {
+        POS left = right;
+        drop_before(left);
+        if(X.empty()) break;
+        right = X[0].right;
+        for(size_t i = 1; i < X.size(); ++i) right = std::min(right, X[i].right);
+        f(left, right, X);
+    }
+}
+
+}
+
+template <typename JUNCTION>
+void tree_sequence_t<JUNCTION>::simplify() {
+    typedef segment_t<position_type> segment;
+
+    int num_founders = founders.num_chromosomes();
+
+    // ancestry[u]: segments of input node u that are ancestral to the
+    // current generation, and the output node they map to
+    std::vector< std::vector< segment > > ancestry(node_time.size());
+    std::vector< int > new_time(num_founders, 0);
+    for(size_t k = 0; k < samples.size(); ++k) {
+        ancestry[samples[k]].push_back(segment(JUNCTION::encode(0.0),
+                                               JUNCTION::encode(1.0),
+                                               new_time.size()));
+        new_time.push_back(node_time[samples[k]]);
+    }
+
+    // parents are visited from young to old, such that the ancestry of all
+    // children of a parent is known when the parent is visited. The output
+    // of the previous simplification is in this order already, and all
+    // edges added since have younger parents, hence only those are sorted.
+    std::vector< edge_t > input;
+    input.reserve(edges.size());
+    input.assign(edges.begin() + num_simplified_edges, edges.end());
+    const std::vector< int >& time = node_time;
+    std::sort(input.begin(), input.end(),
+              [&time](const edge_t& a, const edge_t& b) {
+                  if(time[a.parent] != time[b.parent]) {
+                      return time[a.parent] > time[b.parent];
+                  }
+                  if(a.parent != b.parent) return a.parent < b.parent;
+                  if(a.child != b.child) return a.child < b.child;
+                  return a.left < b.left;
+              });
+    input.insert(input.end(), edges.begin(),
+                 edges.begin() + num_simplified_edges);
+    edges.clear();
+
+    std::vector< segment > Q;
+    std::vector< edge_t > output;
+    for(size_t first = 0; first < input.size(); ) {
+        int u = input[first].parent;
+        size_t last = first;
+
+        Q.clear();
+        for(; last < input.size() && input[last].parent == u; ++last) {
+            const edge_t& e = input[last];
+            // the segments of a child are sorted and do not overlap
+            const std::vector< segment >& child = ancestry[e.child];
+            auto x = std::upper_bound(child.begin(), child.end(), e.left,
+                                      [](position_type p, const segment& y) {
+                                          return p < y.right;
+                                      });
+            for(; x != child.end() && x->left < e.right; ++x) {
+                Q.push_back(segment(std::max(x->left, e.left),
+                                    std::min(x->right, e.right),
+                                    x->node));
+            }
+        }
+        first = last;
+
+        // founders are always kept, with an edge to every ancestral segment
+        output.clear();
+        if(u < num_founders) {
+            for(auto x = Q.begin(); x != Q.end(); ++x) {
+                output.push_back(edge_t(x->left, x->right, u, x->node));
+            }
+        }
+
+        // other nodes only where lineages coalesce
+        int v = -1;
+        std::vector< segment >& A = ancestry[u];
+        if(u >= num_founders) for_each_overlap(Q, [&](position_type l, position_type r,
+                                const std::vector< segment >& X) {
+            int node = X[0].node;
+            if(X.size() > 1) {
+                if(v == -1) {
+                    v = new_time.size();
+                    new_time.push_back(node_time[u]);
+                }
+                for(auto x = X.begin(); x != X.end(); ++x) {
+                    output.push_back(edge_t(l, r, v, x->node));
+                }
+                node = v;
+            }
+            if(!A.empty() && A.back().right == l && A.back().node == node) {
+                A.back().right = r;
+            } else {
+                A.push_back(segment(l, r, node));
+            }
+        });
+
+        // join adjacent edges between the same nodes
+        std::sort(output.begin(), output.end(),
+                  [](const edge_t& a, const edge_t& b) {
+                      if(a.child != b.child) return a.child < b.child;
+                      return a.left < b.left;
+                  });
+        for(auto e = output.begin(); e != output.end(); ++e) {
+            if(!edges.empty() && edges.back().parent == e->parent &&
+               edges.back().child == e->child && edges.back().right == e->left) {
+                edges.back().right = e->right;
+            } else {
+                edges.push_back(*e);
+            }
+        }
+    }
+
+    node_time.swap(new_time);
+    num_simplified_edges = edges.size();
+    for(size_t k = 0; k < samples.size(); ++k) {
+        samples[k] = num_founders + k;
+    }
+}
+
+template <typename JUNCTION>
+Population_t<JUNCTION> tree_sequence_t<JUNCTION>::population() const {
+
+    int num_nodes = node_time.size();
+    int num_founders = founders.num_chromosomes();
+
+    // edges of every child, ordered by position
+    std::vector< size_t > first_edge(num_nodes + 1, 0);
+    std::vector< int > num_children(num_nodes, 0);
+    for(auto e = edges.begin(); e != edges.end(); ++e) {
+        first_edge[e->child + 1]++;
+        num_children[e->parent]++;
+    }
+    for(int u = 0; u < num_nodes; ++u) first_edge[u + 1] += first_edge[u];
+    std::vector< size_t > by_child(edges.size());
+    std::vector< size_t > fill(first_edge.begin(), first_edge.end() - 1);
+    for(size_t i = 0; i < edges.size(); ++i) by_child[fill[edges[i].child]++] = i;
+    for(int u = 0; u < num_nodes; ++u) {
+        std::sort(by_child.begin() + first_edge[u],
+                  by_child.begin() + first_edge[u + 1],
+                  [this](size_t a, size_t b) {
+                      return edges[a].left < edges[b].left;
+                  });
+    }
+
+    // the junctions of a node are built from those of its parents, hence
+    // nodes are visited from old to young. The junctions of a node are
+    // released once all its children have been built.
+    std::vector< int > order(num_nodes);
+    for(int u = 0; u < num_nodes; ++u) order[u] = u;
+    const std::vector< int >& time = node_time;
+    std::stable_sort(order.begin(), order.end(),
+                     [&time](int a, int b) { return time[a] < time[b]; });
+
+    std::vector< std::vector< JUNCTION > > node_junctions(num_nodes);
+    for(int u = 0; u < num_founders; ++u) {
+        chromosome_view<JUNCTION> founder = founders.chromosome(u);
+        node_junctions[u].assign(founder.begin(), founder.end());
+    }
+
+    for(auto it = order.begin(); it != order.end(); ++it) {
+        int u = *it;
+        if(u < num_founders) continue;
+
+        // copy the junctions of the parents, as in do_recombination
+        std::vector< JUNCTION >& chrom = node_junctions[u];
+        for(size_t i = first_edge[u]; i < first_edge[u + 1]; ++i) {
+            const edge_t& e = edges[by_child[i]];
+            const std::vector< JUNCTION >& parent = node_junctions[e.parent];
+
+            // the block of the parent in which the edge starts
+            auto j = std::upper_bound(parent.begin(), parent.end(),
+                                      JUNCTION(e.left, 0)) - 1;
+            if(chrom.empty() || chrom.back().right != j->right) {
+                chrom.push_back(JUNCTION(e.left, j->right));
+            }
+            for(++j; j != parent.end() && j->pos < e.right; ++j) {
+                if(chrom.back().right != j->right) chrom.push_back(*j);
+            }
+
+            if(--num_children[e.parent] == 0) {
+                std::vector< JUNCTION >().swap(node_junctions[e.parent]);
+            }
+        }
+        chrom.push_back(JUNCTION(JUNCTION::encode(1.0), -1));
+    }
+
+    Population_t<JUNCTION> output;
+    output.num_chromosome_pairs = founders.num_chromosome_pairs;
+    output.reserve(samples.size() / 2);
+    for(size_t k = 0; k < samples.size(); ++k) {
+        output.add_chromosome(node_junctions[samples[k]]);
+    }
+    return output;
+}
+
+#define INSTANTIATE_TREE_SEQUENCE(JUNCTION)                                    \
+template struct tree_sequence_t<JUNCTION>;                                     \
+template void record_meiosis<JUNCTION>(                                        \
+    std::vector< tree_sequence_t<JUNCTION>::edge_t >&, int, int, int, double);
+
+INSTANTIATE_TREE_SEQUENCE(junction)
+INSTANTIATE_TREE_SEQUENCE(junction_fixed32)
+INSTANTIATE_TREE_SEQUENCE(junction_fixed64)
@@ -0,0 +1,71 @@
+//
+//  tree_sequence.h
+//
+//
+//  Genealogy recording as an alternative to explicit junctions. Every
+//  chromosome is a node, and an edge records that child inherited the
+//  interval [left, right) from parent. Nodes 0 .. F - 1 are the F
+//  chromosomes of the founding population, the only nodes that carry
+//  junctions. A generation then only costs one edge per inherited segment,
+//  and the junctions of the current generation are reconstructed from the
+//  genealogy when needed. Simplification (Kelleher et al. 2018, "Efficient
+//  pedigree recording for fast population genetics simulation") removes all
+//  nodes and edges that are not ancestral to the current generation.
+//
+
+#ifndef tree_sequence_hpp
+#define tree_sequence_hpp
+
+#include <vector>
+#include "Fish.h"
+#include "Population.h"
+
+template <typename JUNCTION>
+struct tree_sequence_t {
+    typedef typename JUNCTION::position_type position_type;
+
+    struct edge_t {
+        position_type left;
+        position_type right;
+        int parent;
+        int child;
+
+        edge_t(position_type l, position_type r, int p, int c) :
+            left(l), right(r), parent(p), child(c) {}
+    };
+
+    Population_t<JUNCTION> founders;
+    // generation in which a node was born, the founders are born at 0
+    std::vector< int > node_time;
+    std::vector< edge_t > edges;
+    // chromosome k of the current generation is node samples[k]
+    std::vector< int > samples;
+    // edges [0, num_simplified_edges) are the output of the last
+    // simplification
+    size_t num_simplified_edges;
+
+    explicit tree_sequence_t(const Population_t<JUNCTION>& founding_population);
+
+    // adds num_chromosomes nodes born at time as the current generation,
+    // returns the node of its first chromosome
+    int add_generation(int time, size_t num_chromosomes);
+
+    // removes all nodes and edges that are not ancestral to the current
+    // generation. Founders keep their node, the current generation is
+    // renumbered to F, F + 1, ...
+    void simplify();
+
+    // the junctions of the current generation
+    Population_t<JUNCTION> population() const;
+};
+
+// appends to edges the segments that child inherits from a parent with
+// chromosomes parent1 and parent2 of length morgan, drawn by draw_meiosis
+template <typename JUNCTION>
+void record_meiosis(std::vector< typename tree_sequence_t<JUNCTION>::edge_t >& edges,
+                    int child,
+                    int parent1,
+                    int parent2,
+                    double morgan);
+
+#endif /* tree_sequence_hpp */